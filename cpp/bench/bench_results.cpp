@@ -0,0 +1,94 @@
+// Result ingestion throughput as the number of producer threads grows:
+//
+//   mutex   every result push_back'ed under one mutex (the old pushResult)
+//   ring    results pushed into an MpscRing, drained by one consumer thread
+//           (how workers hand detail records to run())
+//   states  ResultStore::set() of closed ports, i.e. the 2-bit state update
+//           every port goes through
+//
+//   bench_results [results_per_round] [max_threads]
+#include "scanner.h"
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+using namespace std;
+
+// run `body(thread_index)` on n threads, return wall seconds
+static double timed(int n, const std::function<void(int)>& body) {
+    std::vector<std::thread> ts;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) ts.emplace_back(body, i);
+    for (auto &t : ts) t.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static ScanResult sample(int port) {
+    ScanResult r;
+    r.port = port;
+    r.open = true;
+    r.banner = "SSH-2.0-OpenSSH_9.0";
+    return r;
+}
+
+int main(int argc, char* argv[]) {
+    int total       = argc > 1 ? atoi(argv[1]) : 2000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)std::max(2u, std::thread::hardware_concurrency());
+
+    printf("%-8s %8s %14s\n", "sink", "threads", "results/s");
+    for (int n = 1; n <= max_threads; n *= 2) {
+        const int per = total / n;
+
+        // mutex + vector
+        {
+            std::mutex mu;
+            std::vector<ScanResult> all;
+            double s = timed(n, [&](int t) {
+                for (int i = 0; i < per; ++i) {
+                    ScanResult r = sample(t * per + i);
+                    std::lock_guard<std::mutex> lk(mu);
+                    all.push_back(std::move(r));
+                }
+            });
+            printf("%-8s %8d %14.0f\n", "mutex", n, (double)per * n / s);
+        }
+
+        // MPSC ring + consumer
+        {
+            MpscRing<ScanResult> ring(4096);
+            std::atomic<int> running{n};
+            std::vector<ScanResult> all;
+            std::thread consumer([&]() {
+                ScanResult r;
+                while (running.load(std::memory_order_acquire) > 0) {
+                    if (ring.tryPop(r)) all.push_back(std::move(r));
+                    else std::this_thread::yield();
+                }
+                while (ring.tryPop(r)) all.push_back(std::move(r));
+            });
+            double s = timed(n, [&](int t) {
+                for (int i = 0; i < per; ++i) {
+                    ScanResult r = sample(t * per + i);
+                    while (!ring.tryPush(r)) std::this_thread::yield();
+                }
+                running.fetch_sub(1, std::memory_order_release);
+            });
+            consumer.join();
+            printf("%-8s %8d %14.0f\n", "ring", n, (double)per * n / s);
+        }
+
+        // 2-bit states
+        {
+            TargetSet one;
+            one.add("127.0.0.1");
+            ResultStore store;
+            store.reset(&one, 0, per * n - 1, 2);
+            double s = timed(n, [&](int t) {
+                // interleaved like the port shards, so threads share words
+                for (int i = 0; i < per; ++i) store.set(0, i * n + t, PortState::Closed);
+            });
+            printf("%-8s %8d %14.0f\n", "states", n, (double)per * n / s);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+
+// =================== alloc ===================
+// Carve from the current block; move on to the next kept block, or add a
+// new one (at least block_size_, larger for an oversized request), when it
+// does not fit.
+char* Arena::alloc(size_t n, size_t align) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    while (cur_ < blocks_.size()) {
+        Block &b = blocks_[cur_];
+        uintptr_t base = (uintptr_t)b.data.get();
+        size_t at = ((base + off_ + align - 1) & ~(uintptr_t)(align - 1)) - base;
+        if (at + n <= b.size) {
+            off_ = at + n;
+            used_ += n;
+            return b.data.get() + at;
+        }
+        ++cur_;
+        off_ = 0;
+    }
+
+    size_t size = std::max(block_size_, n + align);
+    blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+    cur_ = blocks_.size() - 1;
+    uintptr_t base = (uintptr_t)blocks_[cur_].data.get();
+    size_t at = ((base + align - 1) & ~(uintptr_t)(align - 1)) - base;
+    off_ = at + n;
+    used_ += n;
+    return blocks_[cur_].data.get() + at;
+}
+
+// =================== reset ===================
+void Arena::reset() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    cur_ = 0;
+    off_ = 0;
+    used_ = 0;
+}
+
+size_t Arena::used() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return used_;
+}
+
+size_t Arena::reserved() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    size_t total = 0;
+    for (auto &b : blocks_) total += b.size;
+    return total;
+}
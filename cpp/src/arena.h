@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Bump allocator for memory that lives exactly as long as one scan (receive
+// buffers and the like). Blocks are kept across reset(), so after the first
+// scan of a given size a Scanner allocates nothing more; individual
+// allocations are never freed.
+//
+// alloc() takes a lock: it is meant for a few large carve-outs per worker,
+// not for per-port use.
+class Arena {
+public:
+    explicit Arena(size_t block_size = 1 << 20) : block_size_(block_size) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // n bytes aligned to `align` (a power of two); never null
+    char* alloc(size_t n, size_t align = alignof(std::max_align_t));
+
+    // forget every allocation, keep the blocks for the next scan
+    void reset();
+
+    // bytes handed out since the last reset() / held in blocks
+    size_t used() const;
+    size_t reserved() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    size_t cur_ = 0;     // block being carved
+    size_t off_ = 0;     // first free byte in blocks_[cur_]
+    size_t used_ = 0;
+    mutable std::mutex mutex_;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,137 @@
+#include "checkpoint.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+const char* MAGIC = "penrec-checkpoint 1";
+
+std::string toHex(const std::string& s) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(s.size() * 2);
+    for (unsigned char c : s) {
+        out += digits[c >> 4];
+        out += digits[c & 15];
+    }
+    return out;
+}
+
+bool fromHex(const std::string& s, std::string& out) {
+    if (s.size() % 2) return false;
+    out.clear();
+    for (size_t i = 0; i < s.size(); i += 2) {
+        int v = 0;
+        for (size_t j = i; j < i + 2; ++j) {
+            char c = s[j];
+            v <<= 4;
+            if (c >= '0' && c <= '9') v |= c - '0';
+            else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+            else return false;
+        }
+        out += (char)v;
+    }
+    return true;
+}
+
+} // namespace
+
+// =================== save ===================
+int Checkpoint::save(const std::string& path) const {
+    std::ostringstream out;
+    out << MAGIC << "\n"
+        << "targets " << targets << " " << hosts << "\n"
+        << "ports " << first_port << " " << last_port << "\n"
+        << "seed " << seed << "\n"
+        << "position " << position << "\n";
+    for (const ScanResult& r : open) {
+        out << "open " << r.host << " " << r.port << " " << r.probes << " "
+            << (r.banner.empty() ? "-" : toHex(r.banner)) << "\n";
+    }
+    out << "end\n";
+    const std::string data = out.str();
+
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return errno;
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            int err = errno;
+            close(fd);
+            unlink(tmp.c_str());
+            return err;
+        }
+        done += (size_t)n;
+    }
+    if (fsync(fd) < 0 || close(fd) < 0) {
+        int err = errno;
+        unlink(tmp.c_str());
+        return err;
+    }
+    if (rename(tmp.c_str(), path.c_str()) < 0) {
+        int err = errno;
+        unlink(tmp.c_str());
+        return err;
+    }
+    // the rename itself is only durable once the directory is synced
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0) return errno;
+    int err = fsync(dfd) < 0 ? errno : 0;
+    close(dfd);
+    return err;
+}
+
+// =================== load ===================
+int Checkpoint::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return errno ? errno : ENOENT;
+
+    std::string line;
+    if (!std::getline(in, line) || line != MAGIC) return EINVAL;
+
+    // a file cut short at a line boundary would read fine but for the
+    // open ports it lost, hence the closing "end" line
+    int seen = 0;
+    bool ended = false;
+    open.clear();
+    while (!ended && std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "targets") {
+            fields >> targets >> hosts;
+            seen |= 1;
+        } else if (key == "ports") {
+            fields >> first_port >> last_port;
+            seen |= 2;
+        } else if (key == "seed") {
+            fields >> seed;
+            seen |= 4;
+        } else if (key == "position") {
+            fields >> position;
+            seen |= 8;
+        } else if (key == "open") {
+            ScanResult r;
+            std::string banner;
+            fields >> r.host >> r.port >> r.probes >> banner;
+            if (banner != "-" && !fromHex(banner, r.banner)) return EINVAL;
+            r.open = true;
+            open.push_back(std::move(r));
+        } else if (key == "end") {
+            ended = true;
+        } else {
+            continue;
+        }
+        if (fields.fail()) return EINVAL;
+    }
+    return seen == 15 && ended ? 0 : EINVAL;
+}
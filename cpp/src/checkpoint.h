@@ -0,0 +1,36 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "result_store.h"
+
+// Progress of a scan, small enough to rewrite every few seconds: which
+// sweep it is (targets, ports, shuffle seed), how far along the sweep every
+// probe has resolved, and the open ports found so far. Everything before
+// `position` is done; everything from there on is probed again on resume,
+// except the open ports listed here. Closed and filtered ports are not
+// kept.
+//
+// Stored as a short text file closed by an "end" line, so one cut short is
+// refused rather than read without its last open ports. save() writes a
+// temporary file next to `path`, syncs it, renames it over `path` and syncs
+// the directory, so a crash leaves either the old or the new checkpoint,
+// never a torn one.
+struct Checkpoint {
+    uint64_t targets = 0;        // TargetSet::fingerprint()
+    uint64_t hosts = 0;
+    int first_port = 0;
+    int last_port = -1;
+    uint64_t seed = 0;           // 0: sequential sweep
+    uint64_t position = 0;       // sweep positions below this are resolved
+    std::vector<ScanResult> open;
+
+    // 0 or errno
+    int save(const std::string& path) const;
+    // 0, errno, or EINVAL for a file that is not a checkpoint
+    int load(const std::string& path);
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,89 @@
+#ifndef IP_ADDR_H
+#define IP_ADDR_H
+#pragma once
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+
+// A host address of either family, bytes in network order. IPv4 uses the
+// first four bytes and leaves the rest zero, so two addresses are equal iff
+// family and bytes are.
+struct IpAddr {
+    uint8_t family = AF_INET;   // AF_INET or AF_INET6
+    uint8_t bytes[16] = {};
+
+    static IpAddr fromV4(uint32_t addr) {
+        IpAddr a;
+        memcpy(a.bytes, &addr, 4);
+        return a;
+    }
+
+    static IpAddr fromV6(const void* addr) {
+        IpAddr a;
+        a.family = AF_INET6;
+        memcpy(a.bytes, addr, 16);
+        return a;
+    }
+
+    // address of an AF_INET or AF_INET6 sockaddr; false for other families
+    static bool fromSockaddr(const struct sockaddr* sa, IpAddr& out) {
+        if (sa->sa_family == AF_INET) {
+            out = fromV4(((const struct sockaddr_in*)sa)->sin_addr.s_addr);
+            return true;
+        }
+        if (sa->sa_family == AF_INET6) {
+            out = fromV6(&((const struct sockaddr_in6*)sa)->sin6_addr);
+            return true;
+        }
+        return false;
+    }
+
+    bool v6() const { return family == AF_INET6; }
+
+    // the IPv4 address (network order)
+    uint32_t v4() const {
+        uint32_t a;
+        memcpy(&a, bytes, 4);
+        return a;
+    }
+
+    // fill `ss` with this address and `port` (host order); returns the
+    // length to pass to connect()/sendto(). Only the family's own struct
+    // is written.
+    socklen_t toSockaddr(uint16_t port, struct sockaddr_storage& ss) const {
+        if (v6()) {
+            struct sockaddr_in6* s6 = (struct sockaddr_in6*)&ss;
+            memset(s6, 0, sizeof(*s6));
+            s6->sin6_family = AF_INET6;
+            s6->sin6_port = htons(port);
+            memcpy(&s6->sin6_addr, bytes, 16);
+            return sizeof(*s6);
+        }
+        struct sockaddr_in* s4 = (struct sockaddr_in*)&ss;
+        memset(s4, 0, sizeof(*s4));
+        s4->sin_family = AF_INET;
+        s4->sin_port = htons(port);
+        memcpy(&s4->sin_addr, bytes, 4);
+        return sizeof(*s4);
+    }
+
+    // dotted quad or RFC 5952 text
+    std::string toString() const {
+        char buf[INET6_ADDRSTRLEN];
+        inet_ntop(family, bytes, buf, sizeof(buf));
+        return buf;
+    }
+
+    bool operator==(const IpAddr& o) const {
+        return family == o.family && memcmp(bytes, o.bytes, 16) == 0;
+    }
+    bool operator!=(const IpAddr& o) const { return !(*this == o); }
+    bool operator<(const IpAddr& o) const {
+        return family != o.family ? family < o.family : memcmp(bytes, o.bytes, 16) < 0;
+    }
+};
+
+#endif // IP_ADDR_H
@@ -12,70 +12,118 @@ int main(int argc, char* argv[]) {
     cxxopts::Options options("Penrec", "Port Scanner");
 
     options.add_options()
-      ("t,target", "Target IP/hostname", cxxopts::value<std::string>())
+      ("t,target", "Targets: IP, hostname, CIDR or range, comma-separated", cxxopts::value<std::string>())
+      ("target-file", "File with one or more targets per line", cxxopts::value<std::string>())
       ("s,start",  "Start port", cxxopts::value<int>()->default_value("1"))
       ("e,end",    "End port", cxxopts::value<int>()->default_value("1024"))
       ("n,threads","Threads", cxxopts::value<int>()->default_value("100"))
       ("o,timeout","Timeout ms", cxxopts::value<int>()->default_value("500"))
+      ("min-timeout","Lower bound for RTT-based connect timeout (ms)", cxxopts::value<int>()->default_value("50"))
+      ("max-timeout","Upper bound for RTT-based connect timeout (ms), 0 = max(timeout, 2000)", cxxopts::value<int>()->default_value("0"))
+      ("c,concurrency","Max connects in flight", cxxopts::value<int>()->default_value("500"))
+      ("retries",  "Re-probes of a timed-out port", cxxopts::value<int>()->default_value("1"))
+      ("rate",     "Max probes per second, 0 = unlimited", cxxopts::value<double>()->default_value("0"))
+      ("banner-threads", "Banner stage threads", cxxopts::value<int>()->default_value("2"))
+      ("banner-concurrency", "Banner stage connections", cxxopts::value<int>()->default_value("256"))
+      ("banner-timeout", "Banner time per open port (ms)", cxxopts::value<int>()->default_value("3000"))
+      ("engine",   "I/O engine (epoll|uring)", cxxopts::value<std::string>()->default_value("epoll"))
+      ("syn",      "Half-open SYN scan (needs root/CAP_NET_RAW)")
       ("m,mode",   "Mode (open|closed|all)", cxxopts::value<std::string>()->default_value("open"))
+      ("stream",   "Print results in the order they are found instead of port order")
+      ("sequential", "Probe host by host in port order instead of shuffled")
+      ("seed",     "Seed of the shuffled probe order, 0 = random", cxxopts::value<uint64_t>()->default_value("0"))
+      ("checkpoint", "Save scan progress to this file", cxxopts::value<std::string>())
+      ("checkpoint-interval", "Seconds between checkpoints", cxxopts::value<int>()->default_value("10"))
+      ("resume",   "Continue the scan saved in the --checkpoint file")
+      ("dns-server", "DNS server for hostname targets (ip[:port])", cxxopts::value<std::string>())
+      ("S,source", "Local source addresses for connect probes, comma-separated", cxxopts::value<std::string>())
       ("h,help", "Print help");
     
 
     auto result = options.parse(argc, argv);
-    if (result.count("help") || !result.count("target")) {
+    if (result.count("help") || (!result.count("target") && !result.count("target-file"))) {
         print_usage(argv[0]);
         std::cout << options.help() << std::endl;
         return 0;
     }
-    std::string target = result["target"].as<std::string>();
+    std::string target = result.count("target") ? result["target"].as<std::string>() : "";
     int start = result["start"].as<int>();
     int end = result["end"].as<int>();
     int threads = result["threads"].as<int>();
     int timeout_ms = result["timeout"].as<int>();
+    int concurrency = result["concurrency"].as<int>();
+    std::string engine = result["engine"].as<std::string>();
     std::string mode = result["mode"].as<std::string>();
 
     if (end < start) std::swap(start, end);
 
     Scanner sc(target, start, end, threads, timeout_ms);
-    sc.run();
-
-    auto results = sc.getResults();
-    std::sort(results.begin(), results.end(), [](const ScanResult&a, const ScanResult&b){ return a.port < b.port; });
-
-    if (mode == "open") {
-        for (auto &r : results) if (r.open) std::cout << "[+] port:      " << r.port << "   open\n";
-    } else if (mode == "closed") {
-        for (auto &r : results) if (!r.open) std::cout << "[-] port " << r.port << " CLOSED\n";
-    } else {
-        for (auto &r : results) std::cout << (r.open?"[+]":"[-]") << " port " << r.port << (r.open?" OPEN\n":" CLOSED\n");
+    if (result.count("target-file")) sc.addTargetFile(result["target-file"].as<std::string>());
+    sc.setMaxInFlight(concurrency);
+    sc.setTimeoutBounds(result["min-timeout"].as<int>(), result["max-timeout"].as<int>());
+    sc.setRate(result["rate"].as<double>());
+    sc.setRetries(result["retries"].as<int>());
+    sc.setBannerStage(result["banner-threads"].as<int>(), result["banner-concurrency"].as<int>(),
+                      result["banner-timeout"].as<int>());
+    if (engine == "uring") sc.setBackend(Backend::IoUring);
+    else if (engine != "epoll") {
+        std::cerr << "unknown engine: " << engine << "\n";
+        return 1;
+    }
+    if (result.count("syn")) sc.setScanType(ScanType::Syn);
+    sc.setShuffle(result.count("sequential") == 0, result["seed"].as<uint64_t>());
+    if (result.count("checkpoint")) {
+        sc.setCheckpoint(result["checkpoint"].as<std::string>(),
+                         std::max(1, result["checkpoint-interval"].as<int>()) * 1000);
+    }
+    if (result.count("resume")) {
+        if (!result.count("checkpoint")) {
+            std::cerr << "--resume needs --checkpoint <file>\n";
+            return 1;
+        }
+        sc.setResume(true);
+    }
+    if (result.count("dns-server")) sc.setNameServer(result["dns-server"].as<std::string>());
+    if (result.count("source") && sc.addSourceAddresses(result["source"].as<std::string>()) != 0) {
+        std::cerr << "invalid source address: " << result["source"].as<std::string>() << "\n";
+        return 1;
     }
-    // if (argc < 4) {
-    //     std::cerr << "Usage: " << argv[0] << " <target> <start_port> <end_port> [threads] [timeout_ms]\n";
-    //     return 1;
-    // }
-
-    // std::string target = argv[1];
-    // int start = std::stoi(argv[2]);
-    // int end = std::stoi(argv[3]);
-    // int threads = 100;
-    // int timeout_ms = 500;
-
-    // if (argc >= 5) threads = std::stoi(argv[4]);
-    // if (argc >= 6) timeout_ms = std::stoi(argv[5]);
-
-    // Scanner sc(target, start, end, threads, timeout_ms);
-    // sc.run();
-
-    // auto results = sc.getResults();
-    // // sort results by port before printing
-    // std::sort(results.begin(), results.end(), [](const ScanResult&a, const ScanResult&b){ return a.port < b.port; });
-
-    
 
-    // // print text file
-    // std::string text = sc.resultsToTextOpenOnly();
-    // std::cout << text << std::endl;
-    
+    // with several targets every line starts with the host's address; a
+    // hostname is one target though it holds a host slot per family
+    const TargetSet& ts = sc.targets();
+    bool multi = ts.size() - ts.names().size() > 1;
+    auto print = [&](const ScanResult& r) {
+        std::string host = multi ? r.addr.toString() + " " : "";
+        if (mode == "open") {
+            if (r.open) std::cout << "[+] " << host << "port:      " << r.port << "   open\n";
+        } else if (mode == "closed") {
+            if (!r.open) std::cout << "[-] " << host << "port " << r.port << " CLOSED\n";
+        } else {
+            std::cout << (r.open?"[+] ":"[-] ") << host << "port " << r.port << (r.open?" OPEN\n":" CLOSED\n");
+        }
+    };
+
+    // print from the scan's callback: by host and port as soon as every
+    // lower one is resolved, or with --stream in the order ports resolve.
+    // Flushed per line so a pipe sees each port right away; nothing is kept
+    // for afterwards.
+    bool ordered = result.count("stream") == 0;
+    sc.setResultCallback([&](const ScanResult& r) { print(r); std::cout.flush(); }, mode == "open", ordered);
+    sc.setKeepResults(false);
+    sc.run();
+    for (const std::string& name : sc.unresolvedTargets()) {
+        std::cerr << "[!] could not resolve: " << name << "\n";
+    }
+    if (sc.lastError() != 0) {
+        std::cerr << "scan failed: " << strerror(sc.lastError()) << "\n";
+        return 1;
+    }
+    if (result["rate"].as<double>() > 0) {
+        RateStats rs = sc.rateStats();
+        std::cerr << "[*] rate: " << (uint64_t)rs.observed << " probes/s observed, target "
+                  << (uint64_t)rs.target << " (" << rs.probes << " probes)\n";
+    }
 
     return 0;
 }
@@ -83,11 +131,31 @@ int main(int argc, char* argv[]) {
 void print_usage(const char* prog){
     std::cout << "Usage: " << prog << " [OPTIONS]\n\n"
               << "Options:\n"
-              << "  -t, --target    <target>      target host (IP or hostname)\n"
+              << "  -t, --target    <targets>     IPv4/IPv6 addresses, hostnames, CIDR blocks (10.0.0.0/24) or ranges\n"
+              << "                                (10.0.0.1-10.0.0.20, 10.0.0.1-20), comma-separated\n"
+              << "      --target-file <file>      read targets from a file, one or more per line, # comments\n"
               << "  -s, --start     <port>        start port (default 1)\n"
               << "  -e, --end       <port>        end port (default 1024)\n"
               << "  -n, --threads   <num>         threads (default 100)\n"
-              << "  -o, --timeout   <ms>          timeout ms (default 500)\n"
+              << "  -o, --timeout   <ms>          initial connect timeout ms, adapted to the RTT (default 500)\n"
+              << "      --min-timeout <ms>        lower bound of the adaptive timeout (default 50)\n"
+              << "      --max-timeout <ms>        upper bound of the adaptive timeout (default max(timeout, 2000))\n"
+              << "  -c, --concurrency <num>       max connects in flight (default 500)\n"
+              << "      --retries   <num>         re-probe timed-out ports up to num times (default 1)\n"
+              << "      --rate      <pps>         max probes per second, evenly paced (default 0 = unlimited)\n"
+              << "      --banner-threads <num>    banner stage threads (default 2)\n"
+              << "      --banner-concurrency <num> open ports interrogated at once (default 256)\n"
+              << "      --banner-timeout <ms>     max time spent on one open port's banner (default 3000)\n"
+              << "      --engine    <epoll|uring> I/O engine, uring falls back to epoll (default epoll)\n"
+              << "      --syn                     half-open SYN scan (needs root/CAP_NET_RAW)\n"
               << "  -m, --mode      <open|closed|all> output mode (default open)\n"
+              << "      --stream                  print ports in the order they resolve, not port order\n"
+              << "      --sequential              probe host by host in port order (default: shuffled)\n"
+              << "      --seed      <num>         seed of the shuffled probe order (default 0 = random)\n"
+              << "      --checkpoint <file>       save progress and open ports to file while scanning\n"
+              << "      --checkpoint-interval <s> seconds between checkpoints (default 10)\n"
+              << "      --resume                  continue the scan saved in the --checkpoint file\n"
+              << "      --dns-server <ip[:port]>  resolve hostnames there (default: /etc/resolv.conf)\n"
+              << "  -S, --source    <addrs>       spread connect probes over these local addresses, comma-separated\n"
               << "  -h, --help                     show this help\n";
 }
@@ -0,0 +1,76 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded multi-producer / single-consumer ring (Vyukov's array queue).
+// Every cell carries a sequence number that says whose turn it is, so a
+// producer claims a cell with one CAS on the tail and publishes it with one
+// release store; the consumer needs no atomic read-modify-write at all.
+// Neither side ever blocks: tryPush() fails when the ring is full and
+// tryPop() when it is empty.
+template <typename T>
+class MpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscRing(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        mask_ = n - 1;
+        cells_.reset(new Cell[n]);
+        for (size_t i = 0; i < n; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // any thread; `v` is moved from only on success
+    bool tryPush(T& v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = std::move(v);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;   // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer thread only
+    bool tryPop(T& out) {
+        Cell &c = cells_[head_ & mask_];
+        size_t seq = c.seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(head_ + 1) < 0) return false;   // empty
+        out = std::move(c.value);
+        c.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    size_t mask_ = 0;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) size_t head_ = 0;
+};
+
+#endif // MPSC_RING_H
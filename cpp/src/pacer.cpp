@@ -0,0 +1,43 @@
+#include "pacer.h"
+#include <algorithm>
+#include <time.h>
+
+// =================== Pacer ===================
+void Pacer::init(double rate, uint64_t start_ns) {
+    start_ns_ = start_ns;
+    tat_ps_ = 0;
+    // picoseconds keep fractional-nanosecond intervals (rates above 1 Mpps)
+    interval_ps_ = rate > 0 ? std::max<uint64_t>(1, (uint64_t)(1e12 / rate)) : 0;
+}
+
+unsigned Pacer::take(unsigned n, uint64_t now_ns, uint64_t& next_ns) {
+    if (interval_ps_ == 0) return n;
+    if (now_ns < start_ns_) {
+        next_ns = start_ns_;
+        return 0;
+    }
+    const uint64_t slack_ps = SLACK_NS * 1000;
+    uint64_t now_ps = (now_ns - start_ns_) * 1000;
+
+    // slots missed while idle are only kept for SLACK_NS
+    uint64_t tat = std::max(tat_ps_, now_ps > slack_ps ? now_ps - slack_ps : 0);
+    if (tat > now_ps) {
+        next_ns = start_ns_ + (tat + 999) / 1000;
+        return 0;
+    }
+
+    uint64_t avail = (now_ps - tat) / interval_ps_ + 1;
+    unsigned k = (unsigned)std::min<uint64_t>(n, avail);
+    tat_ps_ = tat + k * interval_ps_;
+    return k;
+}
+
+void Pacer::refund(unsigned n) {
+    tat_ps_ -= std::min(tat_ps_, (uint64_t)n * interval_ps_);
+}
+
+uint64_t Pacer::nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
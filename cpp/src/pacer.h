@@ -0,0 +1,39 @@
+#ifndef PACER_H
+#define PACER_H
+#pragma once
+#include <cstdint>
+
+// Token-bucket pacer in its GCRA form: instead of a token count it keeps the
+// theoretical time of the next slot, so slots are spaced exactly 1/rate
+// apart however often take() is polled. Up to SLACK_NS worth of slots may be
+// banked: that absorbs late timer wakeups without losing rate, and at high
+// rates lets a wakeup every ~100 us send a short burst instead of needing
+// one wakeup per probe.
+//
+// One pacer per worker thread; nothing here is thread-safe.
+class Pacer {
+public:
+    Pacer() = default;
+
+    // `rate` slots per second, the first one at start_ns (CLOCK_MONOTONIC)
+    void init(double rate, uint64_t start_ns);
+    bool enabled() const { return interval_ps_ > 0; }
+
+    // grant up to n slots at now_ns; returns how many were granted. When
+    // that is 0, next_ns is the monotonic time the next slot opens.
+    unsigned take(unsigned n, uint64_t now_ns, uint64_t& next_ns);
+    // hand back n slots of the last take() that found nothing to send
+    void refund(unsigned n);
+
+    // CLOCK_MONOTONIC in nanoseconds (the clock timerfd and io_uring use)
+    static uint64_t nowNs();
+
+    static constexpr uint64_t SLACK_NS = 200000;
+
+private:
+    uint64_t start_ns_ = 0;
+    uint64_t interval_ps_ = 0;   // 0: unlimited
+    uint64_t tat_ps_ = 0;        // theoretical time of the next slot, relative to start
+};
+
+#endif // PACER_H
@@ -0,0 +1,189 @@
+#include "packet.h"
+#include <arpa/inet.h>
+#include <cstring>
+
+// =================== checksum ===================
+static uint32_t sumBytes(const void* data, size_t len, uint32_t sum) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 1) {
+        sum += (uint32_t)((p[0] << 8) | p[1]);
+        p += 2;
+        len -= 2;
+    }
+    if (len) sum += (uint32_t)(p[0] << 8);
+    return sum;
+}
+
+static uint16_t fold(uint32_t sum) {
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+uint16_t inetChecksum(const void* data, size_t len, uint32_t sum) {
+    return fold(sumBytes(data, len, sum));
+}
+
+// =================== SynTemplate ===================
+void SynTemplate::init(uint32_t saddr, uint32_t daddr, uint16_t sport) {
+    memset(bytes, 0, sizeof(bytes));
+
+    uint8_t* ip = bytes;
+    ip[0] = 0x45;                       // version 4, IHL 5
+    ip[1] = 0;                          // TOS
+    ip[2] = (uint8_t)(LEN >> 8);        // total length
+    ip[3] = (uint8_t)(LEN & 0xff);
+    ip[4] = ip[5] = 0;                  // id: filled in by the kernel
+    ip[6] = 0x40;                       // DF
+    ip[8] = 64;                         // TTL
+    ip[9] = 6;                          // TCP
+    memcpy(ip + 12, &saddr, 4);
+    memcpy(ip + 16, &daddr, 4);
+    ip_sum = sumBytes(ip, 20, 0);
+    uint16_t ipsum = htons(fold(ip_sum));
+    memcpy(ip + 10, &ipsum, 2);
+
+    uint8_t* tcp = bytes + 20;
+    tcp[0] = (uint8_t)(sport >> 8);
+    tcp[1] = (uint8_t)(sport & 0xff);
+    tcp[12] = (24 / 4) << 4;            // data offset: 6 words
+    tcp[13] = TCP_FLAG_SYN;
+    tcp[14] = 0xfa;                     // window 64240
+    tcp[15] = 0xf0;
+    tcp[20] = 2;                        // MSS option, 1460
+    tcp[21] = 4;
+    tcp[22] = 0x05;
+    tcp[23] = 0xb4;
+
+    // pseudo header: saddr, daddr, zero, protocol, TCP length
+    uint32_t sum = sumBytes(ip + 12, 8, 0);
+    sum += 6;
+    sum += 24;
+    partial_sum = sumBytes(tcp, 24, sum);
+}
+
+void SynTemplate::fill(uint8_t* out, uint16_t dport, uint32_t seq) const {
+    memcpy(out, bytes, LEN);
+    uint8_t* tcp = out + 20;
+    tcp[2] = (uint8_t)(dport >> 8);
+    tcp[3] = (uint8_t)(dport & 0xff);
+    tcp[4] = (uint8_t)(seq >> 24);
+    tcp[5] = (uint8_t)(seq >> 16);
+    tcp[6] = (uint8_t)(seq >> 8);
+    tcp[7] = (uint8_t)(seq);
+
+    uint32_t sum = partial_sum + dport + (seq >> 16) + (seq & 0xffff);
+    uint16_t csum = fold(sum);
+    tcp[16] = (uint8_t)(csum >> 8);
+    tcp[17] = (uint8_t)(csum & 0xff);
+}
+
+void SynTemplate::fillTo(uint8_t* out, uint32_t daddr, uint16_t dport, uint32_t seq) const {
+    memcpy(out, bytes, LEN);
+    uint8_t* ip = out;
+    memcpy(ip + 16, &daddr, 4);
+    uint32_t dsum = sumBytes(ip + 16, 4, 0);
+    uint16_t ipsum = fold(ip_sum + dsum);
+    ip[10] = (uint8_t)(ipsum >> 8);
+    ip[11] = (uint8_t)(ipsum & 0xff);
+
+    uint8_t* tcp = out + 20;
+    tcp[2] = (uint8_t)(dport >> 8);
+    tcp[3] = (uint8_t)(dport & 0xff);
+    tcp[4] = (uint8_t)(seq >> 24);
+    tcp[5] = (uint8_t)(seq >> 16);
+    tcp[6] = (uint8_t)(seq >> 8);
+    tcp[7] = (uint8_t)(seq);
+
+    uint32_t sum = partial_sum + dsum + dport + (seq >> 16) + (seq & 0xffff);
+    uint16_t csum = fold(sum);
+    tcp[16] = (uint8_t)(csum >> 8);
+    tcp[17] = (uint8_t)(csum & 0xff);
+}
+
+// =================== Syn6Template ===================
+void Syn6Template::init(const uint8_t saddr[16], uint16_t sport) {
+    memset(bytes, 0, sizeof(bytes));
+
+    uint8_t* ip = bytes;
+    ip[0] = 0x60;                       // version 6, traffic class 0, flow 0
+    ip[4] = 0;                          // payload length: the TCP header
+    ip[5] = 24;
+    ip[6] = 6;                          // next header: TCP
+    ip[7] = 64;                         // hop limit
+    memcpy(ip + 8, saddr, 16);
+
+    uint8_t* tcp = bytes + 40;
+    tcp[0] = (uint8_t)(sport >> 8);
+    tcp[1] = (uint8_t)(sport & 0xff);
+    tcp[12] = (24 / 4) << 4;
+    tcp[13] = TCP_FLAG_SYN;
+    tcp[14] = 0xfa;                     // window 64240
+    tcp[15] = 0xf0;
+    tcp[20] = 2;                        // MSS option, 1440
+    tcp[21] = 4;
+    tcp[22] = 0x05;
+    tcp[23] = 0xa0;
+
+    // pseudo header: saddr, daddr (added per probe), TCP length, next header
+    uint32_t sum = sumBytes(ip + 8, 16, 0);
+    sum += 24;
+    sum += 6;
+    partial_sum = sumBytes(tcp, 24, sum);
+}
+
+void Syn6Template::fillTo(uint8_t* out, const uint8_t daddr[16], uint16_t dport, uint32_t seq) const {
+    memcpy(out, bytes, LEN);
+    memcpy(out + 24, daddr, 16);
+
+    uint8_t* tcp = out + 40;
+    tcp[2] = (uint8_t)(dport >> 8);
+    tcp[3] = (uint8_t)(dport & 0xff);
+    tcp[4] = (uint8_t)(seq >> 24);
+    tcp[5] = (uint8_t)(seq >> 16);
+    tcp[6] = (uint8_t)(seq >> 8);
+    tcp[7] = (uint8_t)(seq);
+
+    uint32_t sum = sumBytes(daddr, 16, partial_sum) + dport + (seq >> 16) + (seq & 0xffff);
+    uint16_t csum = fold(sum);
+    tcp[16] = (uint8_t)(csum >> 8);
+    tcp[17] = (uint8_t)(csum & 0xff);
+}
+
+// =================== parseIpv4Tcp ===================
+static void readTcp(const uint8_t* tcp, TcpReply& out) {
+    out.sport = (uint16_t)((tcp[0] << 8) | tcp[1]);
+    out.dport = (uint16_t)((tcp[2] << 8) | tcp[3]);
+    out.seq = ((uint32_t)tcp[4] << 24) | ((uint32_t)tcp[5] << 16) | ((uint32_t)tcp[6] << 8) | tcp[7];
+    out.ack = ((uint32_t)tcp[8] << 24) | ((uint32_t)tcp[9] << 16) | ((uint32_t)tcp[10] << 8) | tcp[11];
+    out.flags = tcp[13];
+}
+
+bool parseIpv4Tcp(const uint8_t* pkt, size_t len, TcpReply& out) {
+    if (len < 20 || (pkt[0] >> 4) != 4) return false;
+    size_t ihl = (size_t)(pkt[0] & 0x0f) * 4;
+    size_t total = ((size_t)pkt[2] << 8) | pkt[3];
+    if (ihl < 20 || total < ihl + 20 || total > len) return false;
+    if (pkt[9] != 6) return false;
+    // fragments other than the first carry no TCP header
+    if (((pkt[6] & 0x1f) << 8 | pkt[7]) != 0) return false;
+
+    const uint8_t* tcp = pkt + ihl;
+    uint32_t a;
+    memcpy(&a, pkt + 12, 4);
+    out.saddr = IpAddr::fromV4(a);
+    memcpy(&a, pkt + 16, 4);
+    out.daddr = IpAddr::fromV4(a);
+    readTcp(tcp, out);
+    return true;
+}
+
+// =================== parseIpv6Tcp ===================
+bool parseIpv6Tcp(const uint8_t* pkt, size_t len, TcpReply& out) {
+    if (len < 40 + 20 || (pkt[0] >> 4) != 6 || pkt[6] != 6) return false;
+    size_t payload = ((size_t)pkt[4] << 8) | pkt[5];
+    if (payload < 20 || 40 + payload > len) return false;
+    out.saddr = IpAddr::fromV6(pkt + 8);
+    out.daddr = IpAddr::fromV6(pkt + 24);
+    readTcp(pkt + 40, out);
+    return true;
+}
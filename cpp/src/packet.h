@@ -0,0 +1,77 @@
+#ifndef PACKET_H
+#define PACKET_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ip_addr.h"
+
+// Pre-built IPv4 TCP SYN probe (20 byte IP header + 24 byte TCP header with
+// an MSS option). Everything except the destination port, the sequence
+// number and the TCP checksum is computed once in init(); fill() only
+// patches those fields and folds the checksum from a precomputed partial sum.
+//
+// A template for many hosts is built with daddr 0; fillTo() then also
+// patches the destination address and adds it to both checksums.
+struct SynTemplate {
+    static constexpr size_t LEN = 44;
+
+    uint8_t bytes[LEN];
+    uint32_t partial_sum = 0;  // pseudo header + TCP header with dport = seq = 0
+    uint32_t ip_sum = 0;       // IP header with checksum = 0
+
+    // addresses in network byte order, sport in host byte order
+    void init(uint32_t saddr, uint32_t daddr, uint16_t sport);
+
+    // write a ready-to-send probe for dport (host order) into out[LEN]
+    void fill(uint8_t* out, uint16_t dport, uint32_t seq) const;
+
+    // same for a template initialised with daddr 0: probe daddr:dport
+    void fillTo(uint8_t* out, uint32_t daddr, uint16_t dport, uint32_t seq) const;
+};
+
+// The same probe over IPv6: 40 byte IP header + the 24 byte TCP header.
+// IPv6 has no header checksum, so fillTo() only folds the destination into
+// the TCP one. saddr/daddr are 16 bytes in network order.
+struct Syn6Template {
+    static constexpr size_t LEN = 64;
+
+    uint8_t bytes[LEN];
+    uint32_t partial_sum = 0;  // pseudo header without daddr + TCP header with dport = seq = 0
+
+    void init(const uint8_t saddr[16], uint16_t sport);
+
+    void fillTo(uint8_t* out, const uint8_t daddr[16], uint16_t dport, uint32_t seq) const;
+};
+
+// Fields of a TCP segment that the scan receive path cares about.
+// Ports and numbers are in host order.
+struct TcpReply {
+    IpAddr saddr;
+    IpAddr daddr;
+    uint16_t sport = 0;
+    uint16_t dport = 0;
+    uint32_t seq = 0;
+    uint32_t ack = 0;
+    uint8_t flags = 0;
+};
+
+// TCP flag bits as found in byte 13 of the header
+enum : uint8_t {
+    TCP_FLAG_FIN = 0x01,
+    TCP_FLAG_SYN = 0x02,
+    TCP_FLAG_RST = 0x04,
+    TCP_FLAG_ACK = 0x10,
+};
+
+// parse an IPv4 packet (starting at the IP header); false if it is not a
+// complete, unfragmented TCP segment
+bool parseIpv4Tcp(const uint8_t* pkt, size_t len, TcpReply& out);
+
+// same for an IPv6 packet whose TCP header directly follows the fixed
+// header (SYN-ACKs and RSTs carry no extension headers)
+bool parseIpv6Tcp(const uint8_t* pkt, size_t len, TcpReply& out);
+
+// one's complement sum over `len` bytes, folded into 16 bits
+uint16_t inetChecksum(const void* data, size_t len, uint32_t sum = 0);
+
+#endif // PACKET_H
@@ -0,0 +1,73 @@
+#include "permutation.h"
+#include <random>
+#include <sys/random.h>
+
+namespace {
+
+// splitmix64 (Steele, Lea & Flood): key schedule and round function
+uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+Permutation::Permutation(uint64_t n) : n_(n) { }
+
+Permutation::Permutation(uint64_t n, uint64_t seed) : n_(n) {
+    half_bits_ = 1;
+    while (half_bits_ < 32 && (1ull << (2 * half_bits_)) < n) ++half_bits_;
+    half_mask_ = (1ull << half_bits_) - 1;
+    uint64_t s = seed;
+    for (int r = 0; r < ROUNDS; ++r) {
+        s += 0x9e3779b97f4a7c15ull;
+        keys_[r] = mix64(s);
+    }
+}
+
+// =================== encrypt ===================
+// one pass of the Feistel network over the 2 * half_bits_ domain
+uint64_t Permutation::encrypt(uint64_t x) const {
+    uint64_t left = x >> half_bits_;
+    uint64_t right = x & half_mask_;
+    for (int r = 0; r < ROUNDS; ++r) {
+        uint64_t next = left ^ (mix64(right ^ keys_[r]) & half_mask_);
+        left = right;
+        right = next;
+    }
+    return (left << half_bits_) | right;
+}
+
+uint64_t Permutation::decrypt(uint64_t x) const {
+    uint64_t left = x >> half_bits_;
+    uint64_t right = x & half_mask_;
+    for (int r = ROUNDS - 1; r >= 0; --r) {
+        uint64_t prev = right ^ (mix64(left ^ keys_[r]) & half_mask_);
+        right = left;
+        left = prev;
+    }
+    return (left << half_bits_) | right;
+}
+
+uint64_t Permutation::operator()(uint64_t i) const {
+    if (half_bits_ == 0) return i;
+    // cycle walking: i < n_ lies on a cycle that returns below n_
+    uint64_t x = encrypt(i);
+    while (x >= n_) x = encrypt(x);
+    return x;
+}
+
+uint64_t Permutation::position(uint64_t index) const {
+    if (half_bits_ == 0) return index;
+    uint64_t x = decrypt(index);
+    while (x >= n_) x = decrypt(x);
+    return x;
+}
+
+uint64_t Permutation::randomSeed() {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), 0) == (ssize_t)sizeof(seed)) return seed;
+    std::random_device rd;
+    return ((uint64_t)rd() << 32) | rd();
+}
@@ -0,0 +1,45 @@
+#ifndef PERMUTATION_H
+#define PERMUTATION_H
+#pragma once
+#include <cstdint>
+
+// Pseudorandom permutation of 0 .. n-1 in constant memory, so a scan can
+// visit its (host, port) indexes in shuffled order without a visited set or
+// a shuffled array.
+//
+// A 4-round balanced Feistel network runs over the smallest domain of 2k
+// bits that holds n; indexes it maps to n or beyond are fed through it
+// again ("cycle walking") until they land inside. The domain is less than
+// 4n, so that takes under four rounds of the network on average. The same
+// seed always gives the same order.
+class Permutation {
+public:
+    // identity over n (sequential sweep)
+    explicit Permutation(uint64_t n = 0);
+    // keyed shuffle of n
+    Permutation(uint64_t n, uint64_t seed);
+
+    uint64_t size() const { return n_; }
+    bool shuffled() const { return half_bits_ > 0; }
+
+    // the i-th index of the order (i < size())
+    uint64_t operator()(uint64_t i) const;
+    // inverse: position of `index` in the order (index < size())
+    uint64_t position(uint64_t index) const;
+
+    // fresh seed from the kernel's random pool
+    static uint64_t randomSeed();
+
+private:
+    static constexpr int ROUNDS = 4;
+
+    uint64_t n_;
+    int half_bits_ = 0;     // 0: identity
+    uint64_t half_mask_ = 0;
+    uint64_t keys_[ROUNDS] = {};
+
+    uint64_t encrypt(uint64_t x) const;
+    uint64_t decrypt(uint64_t x) const;
+};
+
+#endif // PERMUTATION_H
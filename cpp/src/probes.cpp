@@ -0,0 +1,133 @@
+#include "probes.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// =================== payloads ===================
+const char HTTP_HEAD[] = "HEAD / HTTP/1.0\r\n\r\n";
+const char SMTP_EHLO[] = "EHLO penrec\r\n";
+const char REDIS_PING[] = "PING\r\n";
+const char MEMCACHED_VERSION[] = "version\r\n";
+
+// PostgreSQL SSLRequest: the server answers with a single 'S' or 'N'
+const char PG_SSL_REQUEST[] = { 0x00, 0x00, 0x00, 0x08, 0x04, (char)0xd2, 0x16, 0x2f };
+
+// TLS 1.2 ClientHello: ECDHE/RSA suites, x25519/P-256/P-384 and the
+// common signature algorithms, no SNI. Enough for a ServerHello or an
+// alert from any TLS stack, either of which identifies the service.
+const unsigned char TLS_CLIENT_HELLO[] = {
+    0x16, 0x03, 0x01, 0x00, 0x71, 0x01, 0x00, 0x00, 0x6d, 0x03, 0x03, 0x00,
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c,
+    0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+    0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x00, 0x00, 0x1a, 0xc0, 0x2b,
+    0xc0, 0x2f, 0xc0, 0x2c, 0xc0, 0x30, 0xcc, 0xa9, 0xcc, 0xa8, 0xc0, 0x13,
+    0xc0, 0x14, 0x00, 0x9c, 0x00, 0x9d, 0x00, 0x2f, 0x00, 0x35, 0x00, 0x0a,
+    0x01, 0x00, 0x00, 0x2a, 0x00, 0x0a, 0x00, 0x08, 0x00, 0x06, 0x00, 0x1d,
+    0x00, 0x17, 0x00, 0x18, 0x00, 0x0b, 0x00, 0x02, 0x01, 0x00, 0x00, 0x0d,
+    0x00, 0x14, 0x00, 0x12, 0x04, 0x03, 0x08, 0x04, 0x04, 0x01, 0x05, 0x03,
+    0x08, 0x05, 0x05, 0x01, 0x08, 0x06, 0x06, 0x01, 0x02, 0x01,
+};
+
+// =================== describe ===================
+std::string describeTls(const char* buf, size_t n) {
+    const unsigned char* p = (const unsigned char*)buf;
+    char out[96];
+    if (n >= 7 && p[0] == 0x15) {
+        snprintf(out, sizeof(out), "TLS alert (level %u, description %u)", p[5], p[6]);
+        return out;
+    }
+    // record header (5) + handshake header (4) + version (2) + random (32)
+    // + session id length (1), then the session id and the chosen suite
+    if (n >= 44 && p[0] == 0x16 && p[5] == 0x02) {
+        size_t sid = p[43];
+        if (n >= 44 + sid + 2) {
+            unsigned suite = (unsigned)(p[44 + sid] << 8 | p[45 + sid]);
+            // version 3.x is TLS 1.(x-1)
+            snprintf(out, sizeof(out), "TLS ServerHello (TLS 1.%d, cipher 0x%04x)",
+                     p[9] == 3 ? p[10] - 1 : -1, suite);
+            return out;
+        }
+    }
+    return "TLS (unrecognised reply)";
+}
+
+std::string describePgSsl(const char* buf, size_t n) {
+    if (n >= 1 && buf[0] == 'S') return "PostgreSQL (SSL supported)";
+    if (n >= 1 && buf[0] == 'N') return "PostgreSQL (no SSL)";
+    return "PostgreSQL?";
+}
+
+// =================== probes ===================
+const ServiceProbe NULL_PROBE   = { "null", nullptr, 0, 300, nullptr };
+const ServiceProbe GREETING     = { "greeting", nullptr, 0, 1000, nullptr };
+const ServiceProbe HTTP         = { "http", HTTP_HEAD, sizeof(HTTP_HEAD) - 1, 1000, nullptr };
+const ServiceProbe TLS          = { "tls", (const char*)TLS_CLIENT_HELLO, sizeof(TLS_CLIENT_HELLO), 1000, describeTls };
+const ServiceProbe SMTP         = { "smtp-ehlo", SMTP_EHLO, sizeof(SMTP_EHLO) - 1, 1000, nullptr };
+const ServiceProbe REDIS        = { "redis-ping", REDIS_PING, sizeof(REDIS_PING) - 1, 500, nullptr };
+const ServiceProbe MEMCACHED    = { "memcached-version", MEMCACHED_VERSION, sizeof(MEMCACHED_VERSION) - 1, 500, nullptr };
+const ServiceProbe PG_SSL       = { "pg-sslrequest", PG_SSL_REQUEST, sizeof(PG_SSL_REQUEST), 500, describePgSsl };
+
+// =================== plans ===================
+const ProbePlan PLAN_DEFAULT   = { { &NULL_PROBE, &HTTP }, 2 };
+const ProbePlan PLAN_GREETING  = { { &GREETING, &HTTP }, 2 };
+const ProbePlan PLAN_SMTP      = { { &GREETING, &SMTP }, 2 };
+const ProbePlan PLAN_HTTP      = { { &HTTP }, 1 };
+const ProbePlan PLAN_TLS       = { { &TLS }, 1 };
+const ProbePlan PLAN_REDIS     = { { &REDIS }, 1 };
+const ProbePlan PLAN_MEMCACHED = { { &MEMCACHED }, 1 };
+const ProbePlan PLAN_PG        = { { &PG_SSL }, 1 };
+
+struct PortPlan {
+    uint16_t port;
+    const ProbePlan* plan;
+};
+
+// sorted by port
+const PortPlan PORT_PLANS[] = {
+    { 21,    &PLAN_GREETING },   // ftp
+    { 22,    &PLAN_GREETING },   // ssh
+    { 23,    &PLAN_GREETING },   // telnet
+    { 25,    &PLAN_SMTP },
+    { 80,    &PLAN_HTTP },
+    { 110,   &PLAN_GREETING },   // pop3
+    { 143,   &PLAN_GREETING },   // imap
+    { 443,   &PLAN_TLS },
+    { 465,   &PLAN_TLS },        // smtps
+    { 587,   &PLAN_SMTP },       // submission
+    { 636,   &PLAN_TLS },        // ldaps
+    { 993,   &PLAN_TLS },        // imaps
+    { 995,   &PLAN_TLS },        // pop3s
+    { 3000,  &PLAN_HTTP },
+    { 3306,  &PLAN_GREETING },   // mysql
+    { 5000,  &PLAN_HTTP },
+    { 5432,  &PLAN_PG },
+    { 5900,  &PLAN_GREETING },   // vnc
+    { 6379,  &PLAN_REDIS },
+    { 8000,  &PLAN_HTTP },
+    { 8008,  &PLAN_HTTP },
+    { 8080,  &PLAN_HTTP },
+    { 8443,  &PLAN_TLS },
+    { 8888,  &PLAN_HTTP },
+    { 9200,  &PLAN_HTTP },       // elasticsearch
+    { 11211, &PLAN_MEMCACHED },
+};
+
+std::string trimmed(const char* buf, size_t n) {
+    std::string out(buf, buf + n);
+    while (!out.empty() && (out.back() == '\n' || out.back() == '\r')) out.pop_back();
+    return out;
+}
+
+} // namespace
+
+std::string ServiceProbe::banner(const char* buf, size_t n) const {
+    return describe ? describe(buf, n) : trimmed(buf, n);
+}
+
+const ProbePlan& probePlanFor(int port) {
+    auto it = std::lower_bound(std::begin(PORT_PLANS), std::end(PORT_PLANS), port,
+                               [](const PortPlan& p, int v) { return p.port < v; });
+    if (it != std::end(PORT_PLANS) && it->port == port) return *it->plan;
+    return PLAN_DEFAULT;
+}
@@ -0,0 +1,36 @@
+#ifndef PROBES_H
+#define PROBES_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One banner probe: what to send after connect (nothing for the null
+// probe, which only waits for a greeting) and how long to wait for the
+// answer on top of the connect timeout.
+struct ServiceProbe {
+    const char* name;
+    const char* payload;     // nullptr: null probe
+    size_t len;
+    int wait_ms;
+    // turns raw reply bytes into the reported banner; nullptr: text, with
+    // trailing CR/LF stripped
+    std::string (*describe)(const char* buf, size_t n);
+
+    std::string banner(const char* buf, size_t n) const;
+};
+
+// Probes to try on one open port, in order, each on the same connection.
+// The plan comes from a compiled-in table of well-known ports: services
+// that greet first (SSH, FTP, SMTP, ...) start with the null probe,
+// HTTP/TLS/Redis ports get their request straight away, and unknown ports
+// wait briefly for a greeting before falling back to HTTP.
+struct ProbePlan {
+    static constexpr int MAX_STEPS = 2;
+    const ServiceProbe* steps[MAX_STEPS];
+    int count;
+};
+
+const ProbePlan& probePlanFor(int port);
+
+#endif // PROBES_H
@@ -0,0 +1,36 @@
+#include "reorder_buffer.h"
+#include <algorithm>
+
+void ReorderBuffer::reset(uint64_t end, Settled settled) {
+    cursor_ = 0;
+    end_ = end;
+    held_.clear();
+    settled_ = std::move(settled);
+}
+
+void ReorderBuffer::add(uint64_t index, const ScanResult& r) {
+    if (index < cursor_ || index >= end_) return;
+    held_[index] = r;
+}
+
+uint64_t ReorderBuffer::resolvedEnd(const ResultStore& states) const {
+    uint64_t idx = cursor_;
+    while (idx < end_ && (states.stateAt(idx) != PortState::Unscanned || (settled_ && settled_(idx)))) ++idx;
+    return idx;
+}
+
+// =================== flush ===================
+// A held record wins over the index's state; otherwise the state stands for
+// the whole result.
+void ReorderBuffer::flush(uint64_t end, const ResultStore& states, const Emit& emit) {
+    end = std::min(end, end_);
+    for (; cursor_ < end; ++cursor_) {
+        auto it = held_.find(cursor_);
+        if (it != held_.end()) {
+            emit(it->second);
+            held_.erase(it);
+        } else if (states.stateAt(cursor_) != PortState::Unscanned) {
+            emit(states.implied(cursor_));
+        }
+    }
+}
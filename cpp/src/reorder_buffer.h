@@ -0,0 +1,47 @@
+#ifndef REORDER_BUFFER_H
+#define REORDER_BUFFER_H
+#pragma once
+#include <functional>
+#include <map>
+#include "result_store.h"
+
+// Turns ports that resolve in any order into a stream in index order (by
+// host, then port). A cursor walks the ResultStore's states: every index up
+// to the first one still unresolved forms a complete prefix and can be
+// emitted. Most ports need nothing beyond their state; the few that do
+// (banner, unusual error) wait here, keyed by index, until the cursor
+// reaches them.
+//
+// Used from a single thread (the one draining the result sink).
+class ReorderBuffer {
+public:
+    using Emit = std::function<void(const ScanResult&)>;
+    using Settled = std::function<bool(uint64_t)>;
+
+    // cover indexes 0 .. end-1. `settled`, if set, names indexes an earlier
+    // (resumed) run resolved: they count as resolved but are not emitted.
+    void reset(uint64_t end, Settled settled = nullptr);
+
+    // hold a result that says more than its state until its turn
+    void add(uint64_t index, const ScanResult& r);
+
+    // end of the resolved prefix: the first index from the cursor on whose
+    // state is still unknown (the end when all are resolved). Read it
+    // *before* collecting the records that go with those states.
+    uint64_t resolvedEnd(const ResultStore& states) const;
+
+    // emit every index from the cursor up to (excluding) `end` and move the
+    // cursor there; indexes never resolved are skipped
+    void flush(uint64_t end, const ResultStore& states, const Emit& emit);
+
+    uint64_t cursor() const { return cursor_; }
+    size_t held() const { return held_.size(); }
+
+private:
+    uint64_t cursor_ = 0;
+    uint64_t end_ = 0;
+    std::map<uint64_t, ScanResult> held_;
+    Settled settled_;
+};
+
+#endif // REORDER_BUFFER_H
@@ -0,0 +1,375 @@
+#include "resolver.h"
+#include "timing_wheel.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <poll.h>
+#include <random>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const uint16_t TYPE_A = 1;
+const uint16_t TYPE_AAAA = 28;
+const int BATCH = 64;
+const size_t MAX_PACKET = 1500;
+
+std::string lower(std::string s) {
+    for (char& c : s) c = (char)tolower((unsigned char)c);
+    return s;
+}
+
+// offset just past the (possibly compressed) name at `off`, 0 if malformed
+size_t skipName(const uint8_t* pkt, size_t len, size_t off) {
+    while (off < len) {
+        uint8_t b = pkt[off];
+        if (b == 0) return off + 1;
+        if ((b & 0xc0) == 0xc0) return off + 2 <= len ? off + 2 : 0;
+        if (b & 0xc0) return 0;
+        off += 1 + (size_t)b;
+    }
+    return 0;
+}
+
+inline uint16_t read16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+} // namespace
+
+// =================== configuration ===================
+int Resolver::setServer(const std::string& server) {
+    std::string host = server;
+    std::string port = "53";
+    if (!server.empty() && server[0] == '[') {
+        size_t close = server.find(']');
+        if (close == std::string::npos) return EINVAL;
+        host = server.substr(1, close - 1);
+        if (close + 1 < server.size()) {
+            if (server[close + 1] != ':') return EINVAL;
+            port = server.substr(close + 2);
+        }
+    } else if (std::count(server.begin(), server.end(), ':') == 1) {
+        size_t colon = server.find(':');
+        host = server.substr(0, colon);
+        port = server.substr(colon + 1);
+    }
+
+    char* end = nullptr;
+    long p = strtol(port.c_str(), &end, 10);
+    if (port.empty() || *end != '\0' || p < 1 || p > 65535) return EINVAL;
+
+    uint8_t bytes[16];
+    IpAddr addr;
+    if (inet_pton(AF_INET, host.c_str(), bytes) == 1) {
+        uint32_t a;
+        memcpy(&a, bytes, 4);
+        addr = IpAddr::fromV4(a);
+    } else if (inet_pton(AF_INET6, host.c_str(), bytes) == 1) {
+        addr = IpAddr::fromV6(bytes);
+    } else {
+        return EINVAL;
+    }
+    server_len_ = addr.toSockaddr((uint16_t)p, server_);
+    return 0;
+}
+
+void Resolver::setTimeout(int timeout_ms, int attempts) {
+    timeout_ms_ = std::max(1, timeout_ms);
+    attempts_ = std::max(1, attempts);
+}
+
+// first nameserver of /etc/resolv.conf, the local one if there is none
+int Resolver::loadResolvConf() {
+    std::ifstream in("/etc/resolv.conf");
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key, value;
+        if (fields >> key >> value && key == "nameserver") {
+            // a scoped IPv6 server (fe80::1%eth0) is not supported
+            if (setServer(value.find(':') != std::string::npos ? "[" + value + "]" : value) == 0) return 0;
+        }
+    }
+    return setServer("127.0.0.1");
+}
+
+// =================== hosts file ===================
+bool Resolver::fromHostsFile(const std::string& name, size_t index, const Handler& done) {
+    if (!hosts_loaded_) {
+        hosts_loaded_ = true;
+        std::ifstream in("/etc/hosts");
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t hash = line.find('#');
+            if (hash != std::string::npos) line.resize(hash);
+            std::istringstream fields(line);
+            std::string text, alias;
+            if (!(fields >> text)) continue;
+            uint8_t bytes[16];
+            IpAddr addr;
+            if (inet_pton(AF_INET, text.c_str(), bytes) == 1) {
+                uint32_t a;
+                memcpy(&a, bytes, 4);
+                addr = IpAddr::fromV4(a);
+            } else if (inet_pton(AF_INET6, text.c_str(), bytes) == 1) {
+                addr = IpAddr::fromV6(bytes);
+            } else {
+                continue;
+            }
+            while (fields >> alias) hosts_.emplace_back(lower(alias), addr);
+        }
+    }
+
+    const std::string key = lower(name);
+    const IpAddr* v4 = nullptr;
+    const IpAddr* v6 = nullptr;
+    bool listed = false;
+    for (const auto &h : hosts_) {
+        if (h.first != key) continue;
+        listed = true;
+        if (!h.second.v6() && !v4) v4 = &h.second;
+        if (h.second.v6() && !v6) v6 = &h.second;
+    }
+    if (!listed) return false;
+    done(index, AF_INET, v4, 0);
+    done(index, AF_INET6, v6, 0);
+    return true;
+}
+
+// =================== encodeQuery ===================
+// Standard recursive query for one name; false if the name cannot be
+// encoded (empty or over-long labels).
+bool Resolver::encodeQuery(const std::string& name, uint16_t type, uint16_t id, std::vector<uint8_t>& out) {
+    std::string n = name;
+    if (!n.empty() && n.back() == '.') n.pop_back();
+    if (n.empty() || n.size() > 253) return false;
+
+    out.assign(12, 0);
+    out[0] = (uint8_t)(id >> 8);
+    out[1] = (uint8_t)id;
+    out[2] = 0x01;          // RD
+    out[5] = 1;             // one question
+    size_t pos = 0;
+    while (pos <= n.size()) {
+        size_t dot = n.find('.', pos);
+        if (dot == std::string::npos) dot = n.size();
+        size_t label = dot - pos;
+        if (label == 0 || label > 63) return false;
+        out.push_back((uint8_t)label);
+        out.insert(out.end(), n.begin() + (long)pos, n.begin() + (long)dot);
+        pos = dot + 1;
+    }
+    out.push_back(0);
+    out.push_back((uint8_t)(type >> 8));
+    out.push_back((uint8_t)type);
+    out.push_back(0);
+    out.push_back(1);       // class IN
+    return true;
+}
+
+// =================== parseAnswer ===================
+bool Resolver::parseAnswer(const uint8_t* pkt, size_t len, const Query& q, IpAddr& addr,
+                           bool& found, int& error) {
+    const size_t qlen = q.packet.size() - 12;
+    if (len < 12 + qlen) return false;
+    if (read16(pkt) != q.id || !(pkt[2] & 0x80) || read16(pkt + 4) != 1) return false;
+    for (size_t i = 0; i < qlen; ++i) {
+        if (tolower(pkt[12 + i]) != tolower(q.packet[12 + i])) return false;
+    }
+
+    found = false;
+    error = 0;
+    int rcode = pkt[3] & 0x0f;
+    if (rcode == 3) {           // NXDOMAIN
+        error = EHOSTUNREACH;
+        return true;
+    }
+    // SERVFAIL & co.: not an answer, the query is sent again on timeout
+    if (rcode != 0) return false;
+
+    const size_t want = q.type == TYPE_A ? 4 : 16;
+    size_t off = 12 + qlen;
+    for (int an = read16(pkt + 6); an > 0; --an) {
+        off = skipName(pkt, len, off);
+        if (off == 0 || off + 10 > len) return true;
+        uint16_t type = read16(pkt + off);
+        uint16_t cls = read16(pkt + off + 2);
+        size_t rdlen = read16(pkt + off + 8);
+        off += 10;
+        if (off + rdlen > len) return true;
+        // CNAMEs are skipped: a recursive server appends the records they lead to
+        if (type == q.type && cls == 1 && rdlen == want) {
+            if (want == 4) {
+                uint32_t a;
+                memcpy(&a, pkt + off, 4);
+                addr = IpAddr::fromV4(a);
+            } else {
+                addr = IpAddr::fromV6(pkt + off);
+            }
+            found = true;
+            return true;
+        }
+        off += rdlen;
+    }
+    return true;
+}
+
+// =================== run ===================
+int Resolver::run(const std::vector<std::string>& names, const Handler& done) {
+    std::vector<Query> queries;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (fromHostsFile(names[i], i, done)) continue;
+        for (uint16_t type : {TYPE_A, TYPE_AAAA}) {
+            Query q;
+            q.name = i;
+            q.type = type;
+            q.id = 0;
+            if (!encodeQuery(names[i], type, 0, q.packet)) {
+                done(i, type == TYPE_A ? AF_INET : AF_INET6, nullptr, EINVAL);
+                continue;
+            }
+            queries.push_back(std::move(q));
+        }
+    }
+    if (queries.empty()) return 0;
+
+    // every query is answered, if only with an error, so no caller waits
+    // on a name forever
+    auto failAll = [&](int err) {
+        for (const Query& q : queries) {
+            if (q.sent >= 0) done(q.name, q.type == TYPE_A ? AF_INET : AF_INET6, nullptr, err);
+        }
+        return err;
+    };
+
+    if (server_len_ == 0) {
+        int err = loadResolvConf();
+        if (err) return failAll(err);
+    }
+    int fd = socket(server_.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return failAll(errno);
+    // connected: the kernel drops datagrams from anyone but the server
+    if (connect(fd, (struct sockaddr*)&server_, server_len_) < 0) {
+        int err = errno;
+        close(fd);
+        return failAll(err);
+    }
+
+    std::mt19937 rng(std::random_device{}());
+    std::vector<int32_t> by_id(65536, -1);
+    std::vector<size_t> active;        // sent, not answered yet
+    size_t next = 0;                   // first query never sent
+    size_t remaining = queries.size();
+
+    auto finish = [&](Query& q, const IpAddr* addr, int error) {
+        by_id[q.id] = -1;
+        q.sent = -1;
+        --remaining;
+        done(q.name, q.type == TYPE_A ? AF_INET : AF_INET6, addr, error);
+    };
+
+    std::vector<uint8_t> bufs(BATCH * MAX_PACKET);
+    struct iovec iov[BATCH];
+    struct mmsghdr msgs[BATCH];
+    size_t outq[BATCH];
+
+    int rc = 0;
+    while (remaining > 0) {
+        uint64_t now = TimingWheel::nowMs();
+
+        // queries due for a resend, then fresh ones up to the window
+        int n = 0;
+        size_t kept = 0;
+        for (size_t qi : active) {
+            Query& q = queries[qi];
+            if (q.sent < 0) continue;
+            if (q.due_ms <= now && q.sent >= attempts_) {
+                finish(q, nullptr, ETIMEDOUT);
+                continue;
+            }
+            active[kept++] = qi;
+            if (q.due_ms <= now && n < BATCH) outq[n++] = qi;
+        }
+        active.resize(kept);
+        while (n < BATCH && active.size() < (size_t)MAX_IN_FLIGHT && next < queries.size()) {
+            Query& q = queries[next];
+            do q.id = (uint16_t)rng(); while (by_id[q.id] >= 0);
+            by_id[q.id] = (int32_t)next;
+            q.packet[0] = (uint8_t)(q.id >> 8);
+            q.packet[1] = (uint8_t)q.id;
+            active.push_back(next);
+            outq[n++] = next++;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            Query& q = queries[outq[i]];
+            iov[i].iov_base = q.packet.data();
+            iov[i].iov_len = q.packet.size();
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int sent = 0;
+        while (sent < n) {
+            int k = sendmmsg(fd, msgs + sent, n - sent, 0);
+            if (k < 0) {
+                if (errno == EINTR) continue;
+                break;   // EAGAIN & co.: what is left goes out on its next due time
+            }
+            sent += k;
+        }
+        // unsent ones count as sent: they are retried (or give up) on timeout
+        for (int i = 0; i < n; ++i) {
+            Query& q = queries[outq[i]];
+            q.due_ms = now + ((uint64_t)timeout_ms_ << std::min(q.sent, 4));
+            ++q.sent;
+        }
+
+        // sleep until a reply or the next due resend
+        uint64_t wake = UINT64_MAX;
+        for (size_t qi : active) {
+            if (queries[qi].sent > 0) wake = std::min(wake, queries[qi].due_ms);
+        }
+        bool more = next < queries.size() && active.size() < (size_t)MAX_IN_FLIGHT;
+        int wait_ms = more ? 0 : wake == UINT64_MAX ? 0 : (int)(wake > now ? wake - now : 0);
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (::poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) {
+            rc = errno;
+            break;
+        }
+
+        for (;;) {
+            for (int i = 0; i < BATCH; ++i) {
+                iov[i].iov_base = bufs.data() + (size_t)i * MAX_PACKET;
+                iov[i].iov_len = MAX_PACKET;
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int got = recvmmsg(fd, msgs, BATCH, 0, nullptr);
+            if (got <= 0) break;
+            for (int i = 0; i < got; ++i) {
+                const uint8_t* pkt = bufs.data() + (size_t)i * MAX_PACKET;
+                size_t len = msgs[i].msg_len;
+                if (len < 12) continue;
+                int32_t qi = by_id[read16(pkt)];
+                if (qi < 0) continue;
+                Query& q = queries[(size_t)qi];
+                IpAddr addr;
+                bool found;
+                int error;
+                if (!parseAnswer(pkt, len, q, addr, found, error)) continue;
+                finish(q, found ? &addr : nullptr, error);
+            }
+            if (got < BATCH) break;
+        }
+    }
+    close(fd);
+    if (rc) failAll(rc);
+    return rc;
+}
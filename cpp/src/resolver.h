@@ -0,0 +1,69 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ip_addr.h"
+
+// Stub resolver for target lists with many hostnames. Every name gets an A
+// and an AAAA query; up to MAX_IN_FLIGHT queries are outstanding at once
+// on one UDP socket, sent and read in sendmmsg()/recvmmsg() batches, and a
+// query without an answer is sent again after its timeout (doubling, up to
+// `attempts` sends). Each answer is handed out as it arrives, so a caller
+// can start using the first addresses while later names are still pending.
+//
+// /etc/hosts is consulted first, like getaddrinfo() would: a name found
+// there is answered from the file alone. Names are queried as given, no
+// search domains are appended. The nameserver is the first one in
+// /etc/resolv.conf unless set with setServer().
+//
+// Used from a single thread.
+class Resolver {
+public:
+    // one per (name, family): `addr` is the first address of that family,
+    // nullptr when the name has none (or does not resolve: `error` is then
+    // EHOSTUNREACH for NXDOMAIN, ETIMEDOUT when no server answered)
+    using Handler = std::function<void(size_t name, int family, const IpAddr* addr, int error)>;
+
+    static constexpr int MAX_IN_FLIGHT = 512;
+
+    // "ip" or "ip:port" ("[ipv6]:port"); 0 or EINVAL
+    int setServer(const std::string& server);
+    void setTimeout(int timeout_ms, int attempts);
+
+    // resolve every name, calling `done` twice per name; returns once all
+    // are answered. 0 or errno (no usable nameserver, socket errors).
+    int run(const std::vector<std::string>& names, const Handler& done);
+
+private:
+    struct Query {
+        size_t name;
+        uint16_t type;          // 1 (A) or 28 (AAAA)
+        uint16_t id;
+        int sent = 0;
+        uint64_t due_ms = 0;    // next resend
+        std::vector<uint8_t> packet;
+    };
+
+    struct sockaddr_storage server_ {};
+    socklen_t server_len_ = 0;
+    int timeout_ms_ = 1000;
+    int attempts_ = 3;
+
+    int loadResolvConf();
+    // answers from /etc/hosts; returns true if `name` is listed there
+    bool fromHostsFile(const std::string& name, size_t index, const Handler& done);
+    // first A/AAAA record of a response to `q`; false if `pkt` does not
+    // answer it. `error` is set for NXDOMAIN and server failures.
+    static bool parseAnswer(const uint8_t* pkt, size_t len, const Query& q, IpAddr& addr,
+                            bool& found, int& error);
+    static bool encodeQuery(const std::string& name, uint16_t type, uint16_t id, std::vector<uint8_t>& out);
+
+    std::vector<std::pair<std::string, IpAddr>> hosts_;   // /etc/hosts, lower-cased names
+    bool hosts_loaded_ = false;
+};
+
+#endif // RESOLVER_H
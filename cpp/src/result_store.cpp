@@ -0,0 +1,166 @@
+#include "result_store.h"
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+
+// =================== reset ===================
+void ResultStore::reset(const TargetSet* targets, int first_port, int last_port, int filtered_probes) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    freeChunks();
+    targets_ = targets;
+    first_ = first_port;
+    last_ = last_port;
+    filtered_probes_ = std::max(1, filtered_probes);
+    nports_ = last_ >= first_ ? (uint64_t)(last_ - first_ + 1) : 0;
+    size_ = targets_ ? targets_->size() * nports_ : 0;
+    nchunks_ = (size_ + CHUNK - 1) / CHUNK;
+    chunks_.reset(new std::atomic<Word*>[nchunks_]);
+    for (uint64_t c = 0; c < nchunks_; ++c) chunks_[c].store(nullptr, std::memory_order_relaxed);
+    details_.clear();
+    details_.shrink_to_fit();
+    sorted_ = true;
+}
+
+void ResultStore::freeChunks() {
+    for (uint64_t c = 0; c < nchunks_; ++c) delete[] chunks_[c].load(std::memory_order_relaxed);
+    chunks_.reset();
+    nchunks_ = 0;
+}
+
+// chunk `c`, allocated by whichever thread gets there first
+ResultStore::Word* ResultStore::chunk(uint64_t c) {
+    Word* words = chunks_[c].load(std::memory_order_acquire);
+    if (words) return words;
+    Word* fresh = new Word[CHUNK_WORDS]();
+    if (chunks_[c].compare_exchange_strong(words, fresh, std::memory_order_acq_rel)) return fresh;
+    delete[] fresh;
+    return words;
+}
+
+PortState ResultStore::stateOf(const ScanResult& r) {
+    if (r.open) return PortState::Open;
+    if (r.error_code == ECONNREFUSED) return PortState::Closed;
+    return PortState::Filtered;
+}
+
+ScanResult ResultStore::implied(uint64_t index, PortState s, const IpAddr& addr) const {
+    ScanResult r;
+    r.host = nports_ ? index / nports_ : 0;
+    r.addr = addr;
+    r.port = first_ + (int)(nports_ ? index % nports_ : 0);
+    r.open = (s == PortState::Open);
+    r.error_code = s == PortState::Closed ? ECONNREFUSED : s == PortState::Filtered ? ETIMEDOUT : 0;
+    r.probes = s == PortState::Filtered ? filtered_probes_ : 1;
+    return r;
+}
+
+ScanResult ResultStore::implied(uint64_t index) const {
+    uint64_t host = index / nports_;
+    return implied(index, stateAt(index), targets_->address(host));
+}
+
+// =================== set ===================
+// Each port is reported once, so its two bits start at 0 and are only ever
+// OR-ed in; indexes of one word belong to different workers (shards
+// interleave), hence the atomic.
+void ResultStore::set(uint64_t host, int port, PortState s) {
+    if (port < first_ || port > last_) return;
+    uint64_t idx = index(host, port);
+    if (idx >= size_) return;
+    Word* words = chunk(idx / CHUNK);
+    uint64_t off = idx % CHUNK;
+    words[off / 32].fetch_or((uint64_t)s << (2 * (off % 32)), std::memory_order_release);
+}
+
+bool ResultStore::implies(const ScanResult& r) const {
+    ScanResult base = implied(0, stateOf(r), IpAddr());
+    return r.banner.empty() && r.error_code == base.error_code && r.probes == base.probes;
+}
+
+// =================== addDetails ===================
+void ResultStore::addDetails(std::vector<ScanResult>& details) {
+    if (details.empty()) return;
+    std::lock_guard<std::mutex> lk(mutex_);
+    details_.insert(details_.end(), std::make_move_iterator(details.begin()),
+                    std::make_move_iterator(details.end()));
+    sorted_ = false;
+    details.clear();
+}
+
+PortState ResultStore::state(uint64_t host, int port) const {
+    if (port < first_ || port > last_) return PortState::Unscanned;
+    return stateAt(index(host, port));
+}
+
+PortState ResultStore::stateAt(uint64_t idx) const {
+    if (idx >= size_) return PortState::Unscanned;
+    const Word* words = chunks_[idx / CHUNK].load(std::memory_order_acquire);
+    if (!words) return PortState::Unscanned;
+    uint64_t off = idx % CHUNK;
+    uint64_t w = words[off / 32].load(std::memory_order_acquire);
+    return (PortState)((w >> (2 * (off % 32))) & 3);
+}
+
+size_t ResultStore::count(PortState s) const {
+    size_t n = 0;
+    for (uint64_t c = 0; c < nchunks_; ++c) {
+        uint64_t end = std::min(size_, (c + 1) * CHUNK);
+        if (!chunks_[c].load(std::memory_order_acquire)) {
+            if (s == PortState::Unscanned) n += end - c * CHUNK;
+            continue;
+        }
+        for (uint64_t idx = c * CHUNK; idx < end; ++idx) n += (stateAt(idx) == s);
+    }
+    return n;
+}
+
+std::vector<ScanResult> ResultStore::details(bool open_only) const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<ScanResult> out;
+    for (const auto &r : details_) {
+        if (!open_only || r.open) out.push_back(r);
+    }
+    return out;
+}
+
+// =================== materialize ===================
+// Walk the states in index order and merge in the (sorted) detail records.
+std::vector<ScanResult> ResultStore::materialize(bool open_only) const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!sorted_) {
+        std::sort(details_.begin(), details_.end(), [this](const ScanResult& a, const ScanResult& b) {
+            return index(a.host, a.port) < index(b.host, b.port);
+        });
+        sorted_ = true;
+    }
+
+    std::vector<ScanResult> out;
+    if (!targets_) return out;
+    TargetSet::Cursor hosts(*targets_);
+    size_t d = 0;
+    for (uint64_t c = 0; c < nchunks_; ++c) {
+        if (!chunks_[c].load(std::memory_order_acquire)) continue;
+        uint64_t end = std::min(size_, (c + 1) * CHUNK);
+        for (uint64_t idx = c * CHUNK; idx < end; ++idx) {
+            PortState s = stateAt(idx);
+            if (s == PortState::Unscanned || (open_only && s != PortState::Open)) continue;
+            while (d < details_.size() && index(details_[d].host, details_[d].port) < idx) ++d;
+            if (d < details_.size() && index(details_[d].host, details_[d].port) == idx) {
+                out.push_back(details_[d]);
+            } else {
+                out.push_back(implied(idx, s, hosts.address(idx / nports_)));
+            }
+        }
+    }
+    return out;
+}
+
+size_t ResultStore::memoryBytes() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    size_t n = nchunks_ * sizeof(Word*) + details_.capacity() * sizeof(ScanResult);
+    for (uint64_t c = 0; c < nchunks_; ++c) {
+        if (chunks_[c].load(std::memory_order_acquire)) n += CHUNK_WORDS * sizeof(Word);
+    }
+    for (const auto &r : details_) n += r.banner.capacity();
+    return n;
+}
@@ -0,0 +1,112 @@
+#ifndef RESULT_STORE_H
+#define RESULT_STORE_H
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "targets.h"
+
+struct ScanResult {
+    uint64_t host = 0;    // number of the target in the scan's TargetSet
+    IpAddr addr;          // its address
+    int port = 0;
+    bool open = false;
+    std::string banner;   // optional
+    int error_code = 0;   // errno-like
+    int probes = 1;       // probes sent; > 1 when earlier ones went unanswered
+};
+
+// What a scan learned about a port, in 2 bits.
+enum class PortState : uint8_t {
+    Unscanned = 0,
+    Open      = 1,
+    Closed    = 2,   // refused (RST)
+    Filtered  = 3,   // no answer, or any other error
+};
+
+// Compact results of a scan: hosts x ports, numbered host-major (index =
+// host * ports + port offset). Every (host, port) costs 2 bits of state; a
+// full ScanResult is only kept where the state alone does not say it all (a
+// banner, an unusual error, an unusual probe count). A 65535-port scan of a
+// host with a handful of open ports takes ~16 KB.
+//
+// States live in chunks of CHUNK indexes allocated on first use, so a large
+// target set costs nothing for the parts the scan has not reached.
+//
+// set() is lock-free, so workers set states as they go and only queue the
+// few detail records for a locked addDetails(). set() publishes with
+// release order: whatever a worker did before setting a port's state (e.g.
+// queueing its detail record) is visible to a thread that sees the state.
+class ResultStore {
+public:
+    ResultStore() = default;
+    ~ResultStore() { freeChunks(); }
+    ResultStore(const ResultStore&) = delete;
+    ResultStore& operator=(const ResultStore&) = delete;
+
+    // forget everything and cover ports first..last of every host in
+    // `targets` (which must outlive the results); a filtered port normally
+    // took `filtered_probes` probes (1 + retries)
+    void reset(const TargetSet* targets, int first_port, int last_port, int filtered_probes);
+
+    // number of (host, port) indexes
+    uint64_t size() const { return size_; }
+    uint64_t index(uint64_t host, int port) const { return host * nports_ + (uint64_t)(port - first_); }
+
+    // record the state of host:port. Safe to call from several threads.
+    void set(uint64_t host, int port, PortState s);
+
+    // true if r's state alone says everything r does; otherwise r needs a
+    // detail record (pass it to addDetails)
+    bool implies(const ScanResult& r) const;
+
+    // the ScanResult an index's state stands for without a detail record
+    ScanResult implied(uint64_t index) const;
+
+    // take over detail records from a worker (moved out, `details` cleared)
+    void addDetails(std::vector<ScanResult>& details);
+
+    PortState state(uint64_t host, int port) const;
+    PortState stateAt(uint64_t index) const;
+    size_t count(PortState s) const;
+
+    // copy of the detail records (all, or the open ports'), unordered
+    std::vector<ScanResult> details(bool open_only) const;
+
+    // full results of every scanned port, or only of the open ones, in
+    // index order (by host, then port)
+    std::vector<ScanResult> materialize(bool open_only) const;
+
+    // bytes held by states and detail records
+    size_t memoryBytes() const;
+
+    static PortState stateOf(const ScanResult& r);
+
+private:
+    static constexpr uint64_t CHUNK = 1 << 16;       // indexes per chunk
+    static constexpr uint64_t CHUNK_WORDS = CHUNK / 32;
+    using Word = std::atomic<uint64_t>;
+
+    const TargetSet* targets_ = nullptr;
+    int first_ = 0;
+    int last_ = -1;
+    uint64_t nports_ = 0;
+    uint64_t size_ = 0;
+    int filtered_probes_ = 1;
+    uint64_t nchunks_ = 0;
+    std::unique_ptr<std::atomic<Word*>[]> chunks_;   // 32 indexes per word
+
+    mutable std::mutex mutex_;
+    mutable std::vector<ScanResult> details_;
+    mutable bool sorted_ = true;
+
+    ScanResult implied(uint64_t index, PortState s, const IpAddr& addr) const;
+    Word* chunk(uint64_t c);
+    void freeChunks();
+};
+
+#endif // RESULT_STORE_H
@@ -0,0 +1,56 @@
+#include "rtt.h"
+#include <algorithm>
+#include <chrono>
+
+// =================== RttEstimator ===================
+RttEstimator::RttEstimator(int initial_ms, int min_ms, int max_ms)
+    : initial_ms_(initial_ms),
+      min_ms_(min_ms),
+      max_ms_(std::max(min_ms, max_ms))
+{ }
+
+uint64_t RttEstimator::nowUs() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void RttEstimator::sample(uint64_t rtt_us) {
+    int64_t r = (int64_t)rtt_us;
+    int64_t srtt = srtt_us_.load(std::memory_order_relaxed);
+    if (srtt < 0) {
+        rttvar_us_.store(r / 2, std::memory_order_relaxed);
+        srtt_us_.store(r, std::memory_order_relaxed);
+        return;
+    }
+    // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+    int64_t var = rttvar_us_.load(std::memory_order_relaxed);
+    int64_t err = srtt > r ? srtt - r : r - srtt;
+    rttvar_us_.store(var - var / 4 + err / 4, std::memory_order_relaxed);
+    srtt_us_.store(srtt - srtt / 8 + r / 8, std::memory_order_relaxed);
+}
+
+int RttEstimator::timeoutMs() const {
+    int64_t srtt = srtt_us_.load(std::memory_order_relaxed);
+    if (srtt < 0) return std::min(std::max(initial_ms_, min_ms_), max_ms_);
+    // 1 ms clock granularity term from RFC 6298
+    int64_t rto_us = srtt + std::max<int64_t>(1000, 4 * rttvar_us_.load(std::memory_order_relaxed));
+    int64_t rto_ms = (rto_us + 999) / 1000;
+    return (int)std::min<int64_t>(std::max<int64_t>(rto_ms, min_ms_), max_ms_);
+}
+
+// =================== RttTable ===================
+RttTable::RttTable(uint64_t hosts, int initial_ms, int min_ms, int max_ms)
+    : per_host_(hosts <= MAX_ESTIMATORS)
+{
+    uint64_t n = per_host_ ? std::max<uint64_t>(hosts, 1) : MAX_ESTIMATORS;
+    for (uint64_t k = 0; k < n; ++k) slots_.emplace_back(initial_ms, min_ms, max_ms);
+}
+
+RttEstimator& RttTable::forHost(uint64_t host, const IpAddr& addr) {
+    if (per_host_) return slots_[host];
+    // the network: all but the last address byte, FNV-1a hashed
+    const int len = addr.v6() ? 15 : 3;
+    uint64_t h = 1469598103934665603ull ^ addr.family;
+    for (int b = 0; b < len; ++b) h = (h ^ addr.bytes[b]) * 1099511628211ull;
+    return slots_[h % MAX_ESTIMATORS];
+}
@@ -0,0 +1,55 @@
+#ifndef RTT_H
+#define RTT_H
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include "ip_addr.h"
+
+// Jacobson/Karels round-trip estimator (RFC 6298) for one host, fed with
+// connect RTTs (time from connect() to SYN-ACK or RST). timeoutMs() is
+// SRTT + 4 * RTTVAR clamped to [min_ms, max_ms], or initial_ms until the
+// first sample. Several workers may update it concurrently without a lock;
+// a lost update only costs one sample.
+class RttEstimator {
+public:
+    RttEstimator(int initial_ms, int min_ms, int max_ms);
+
+    void sample(uint64_t rtt_us);
+    int timeoutMs() const;
+
+    // -1 until the first sample
+    int64_t srttUs() const { return srtt_us_.load(std::memory_order_relaxed); }
+
+    // monotonic clock in microseconds
+    static uint64_t nowUs();
+
+private:
+    std::atomic<int64_t> srtt_us_{-1};
+    std::atomic<int64_t> rttvar_us_{0};
+    int initial_ms_;
+    int min_ms_;
+    int max_ms_;
+};
+
+// One RttEstimator per target host, so a fast nearby host does not pull the
+// timeout of slower ones down to min_ms; a host starts at initial_ms until
+// its own first sample. Scans of more than MAX_ESTIMATORS hosts share one
+// estimator per /24 (IPv4) or /120 (IPv6) network instead, hashed into a
+// table of that size. Built before the workers start, then used from all
+// of them.
+class RttTable {
+public:
+    static constexpr uint64_t MAX_ESTIMATORS = 65536;
+
+    RttTable(uint64_t hosts, int initial_ms, int min_ms, int max_ms);
+
+    // estimator of host number `host`, whose address is `addr`
+    RttEstimator& forHost(uint64_t host, const IpAddr& addr);
+
+private:
+    std::deque<RttEstimator> slots_;
+    bool per_host_;
+};
+
+#endif // RTT_H
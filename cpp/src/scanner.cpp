@@ -9,170 +9,829 @@ Scanner::Scanner(const std::string& target, int start_port, int end_port,
       end_port_(end_port),
       max_threads_(std::max(1, threads)),
       timeout_ms_(std::max(100, timeout_ms))
-{ }
+{
+    addTargets(target);
+}
+
+int Scanner::addTargets(const std::string& specs) {
+    int err = targets_.add(specs);
+    if (err && !target_error_) target_error_ = err;
+    return err;
+}
+
+int Scanner::addTargetFile(const std::string& path) {
+    int err = targets_.addFile(path);
+    if (err && !target_error_) target_error_ = err;
+    return err;
+}
+
+void Scanner::setMaxInFlight(int n) {
+    max_in_flight_ = std::max(1, n);
+}
+
+void Scanner::setBackend(Backend b) {
+    backend_ = b;
+}
+
+void Scanner::setScanType(ScanType t) {
+    scan_type_ = t;
+}
+
+void Scanner::setTimeoutBounds(int min_ms, int max_ms) {
+    min_timeout_ms_ = std::max(1, min_ms);
+    max_timeout_ms_ = max_ms > 0 ? std::max(min_timeout_ms_, max_ms) : 0;
+}
+
+void Scanner::setRetries(int n) {
+    max_retries_ = std::min(std::max(0, n), MAX_RETRIES);
+}
+
+void Scanner::setBannerStage(int threads, int concurrency, int timeout_ms) {
+    banner_threads_ = std::max(1, threads);
+    banner_concurrency_ = std::max(1, concurrency);
+    banner_timeout_ms_ = std::max(1, timeout_ms);
+}
+
+void Scanner::setResultCallback(ResultCallback cb, bool open_only, bool ordered) {
+    result_cb_ = std::move(cb);
+    stream_all_ = !open_only;
+    ordered_ = ordered;
+}
+
+void Scanner::setShuffle(bool shuffle, uint64_t seed) {
+    shuffle_ = shuffle;
+    seed_ = seed;
+}
+
+void Scanner::setCheckpoint(const std::string& path, int interval_ms) {
+    checkpoint_path_ = path;
+    checkpoint_interval_ms_ = std::max(1, interval_ms);
+}
+
+void Scanner::setResume(bool resume) {
+    resume_ = resume;
+}
+
+void Scanner::setKeepResults(bool keep) {
+    keep_results_ = keep;
+}
+
+void Scanner::setRate(double per_sec) {
+    rate_ = std::max(0.0, per_sec);
+}
+
+void Scanner::setNameServer(const std::string& server) {
+    name_server_ = server;
+}
+
+int Scanner::addSourceAddresses(const std::string& addrs) {
+    return sources_.add(addrs);
+}
+
+RateStats Scanner::rateStats() const {
+    RateStats s;
+    s.target = rate_;
+    s.probes = probes_sent_.load();
+    uint64_t last = last_probe_ns_.load();
+    // n evenly paced probes span n - 1 intervals
+    if (s.probes > 1 && last > pace_start_ns_) {
+        s.observed = (double)(s.probes - 1) * 1e9 / (double)(last - pace_start_ns_);
+    }
+    return s;
+}
+
+// =================== pacing ===================
+void Scanner::initPacer(Pacer& pacer, int shard, int nshards) const {
+    if (rate_ <= 0) return;
+    double share = rate_ / nshards;
+    uint64_t offset_ns = (uint64_t)(shard * 1e9 / rate_);
+    pacer.init(share, pace_start_ns_ + offset_ns);
+}
+
+void Scanner::countProbes(uint64_t n, uint64_t last_ns) {
+    probes_sent_.fetch_add(n);
+    uint64_t cur = last_probe_ns_.load();
+    while (cur < last_ns && !last_probe_ns_.compare_exchange_weak(cur, last_ns)) { }
+}
+
+// =================== fdBudget ===================
+// Number of sockets the scan may keep open at once. Raises the soft
+// RLIMIT_NOFILE towards `wanted` (bounded by the hard limit) and keeps
+// `reserve` descriptors back for stdio, epoll fds and the rest of the process.
+static int fdBudget(int wanted, int reserve) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0) return wanted;
+
+    rlim_t need = (rlim_t)wanted + (rlim_t)reserve;
+    if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < need) {
+        struct rlimit raised = rl;
+        raised.rlim_cur = (rl.rlim_max == RLIM_INFINITY) ? need : std::min(need, rl.rlim_max);
+        if (setrlimit(RLIMIT_NOFILE, &raised) == 0) rl = raised;
+    }
+
+    if (rl.rlim_cur == RLIM_INFINITY) return wanted;
+    long avail = (long)rl.rlim_cur - reserve;
+    return (int)std::max(1L, std::min((long)wanted, avail));
+}
 
 // =================== Public run ===================
-// Replace the entire Scanner::run() with this implementation
-// --- debug-enabled run() (insert or replace your existing run())
+// Splits the (host, port) index space of all targets into one shard per
+// worker; every host shares the same in-flight window. The space is walked
+// in order_, a pseudorandom permutation, so consecutive probes go to
+// different hosts and ports and no single host sees a burst. Every worker is an
+// independent reactor with its own epoll fd, so the connect/syscall rate
+// scales with cores instead of a single loop.
+//
+// Open ports are interrogated by a second stage (bannerLoop) with its own
+// threads, concurrency and timeout, fed through a bounded queue, so slow
+// services never hold up discovery.
 void Scanner::run() {
-    // Resolve once (IPv4)
-    struct addrinfo hints;
-    struct addrinfo *res = nullptr;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    int gai = getaddrinfo(target_.c_str(), nullptr, &hints, &res);
-    if (gai != 0 || res == nullptr) {
-        std::lock_guard<std::mutex> lk(results_mutex_);
-        if (res) freeaddrinfo(res);
+    last_error_ = target_error_;
+    results_.reset(&targets_, start_port_, end_port_, max_retries_ + 1);
+    reorder_.reset(results_.size());
+    if (last_error_ != 0) return;
+
+    uint64_t total = results_.size();
+    if (total == 0) return;
+
+    order_seed_ = seed_ ? seed_ : Permutation::randomSeed();
+    order_ = shuffle_ ? Permutation(total, order_seed_) : Permutation(total);
+
+    // pick up where a checkpointed run stopped, and make sure the
+    // checkpoint file can be written before any work depends on it
+    resume_pos_ = 0;
+    resumed_ahead_ = 0;
+    if (resume_ || !targets_.names().empty()) {
+        reorder_.reset(total, [this](uint64_t idx) {
+            return (resume_pos_ && order_.position(idx) < resume_pos_) || absent(idx);
+        });
+    }
+
+    // hostnames resolve while the sweep starts on the addresses; a resumed
+    // scan needs them before it restores its open ports
+    last_error_ = startResolver();
+    if (last_error_ != 0) return;
+    if (resume_) {
+        joinResolver();
+        int err = resumeCheckpoint();
+        if (err != 0) last_error_ = err;
+        if (last_error_ != 0) return;
+    }
+    checkpoint_pos_ = resume_pos_;
+    if (!checkpoint_path_.empty()) {
+        last_error_ = saveCheckpoint(checkpoint_pos_);
+        if (last_error_ != 0) {
+            joinResolver();
+            return;
+        }
+        next_checkpoint_ms_ = TimingWheel::nowMs() + (uint64_t)checkpoint_interval_ms_;
+    }
+
+    probes_sent_ = 0;
+    last_probe_ns_ = 0;
+    pace_start_ns_ = Pacer::nowNs();
+
+    if (!sink_) sink_.reset(new MpscRing<Resolved>(SINK_CAPACITY));
+    sink_consumer_ = std::this_thread::get_id();
+
+    if (scan_type_ == ScanType::Syn) {
+        // routes and the capture filter are chosen from the addresses
+        joinResolver();
+        if (last_error_ != 0) return;
+        runSyn();
+        finishStream();
+        return;
+    }
+
+    // every source address must be usable before the first connect
+    last_error_ = sources_.prepare();
+    if (last_error_ != 0) {
+        joinResolver();
         return;
     }
 
-    struct sockaddr_in base_addr;
-    memset(&base_addr, 0, sizeof(base_addr));
-    if (res->ai_addr && res->ai_addrlen >= (socklen_t)sizeof(sockaddr_in)) {
-        memcpy(&base_addr, res->ai_addr, sizeof(sockaddr_in));
-    } else {
-        base_addr.sin_family = AF_INET;
-        base_addr.sin_addr.s_addr = INADDR_ANY;
+    // connect timeouts start at timeout_ms_ and then follow the measured RTT
+    int max_timeout = max_timeout_ms_ > 0 ? max_timeout_ms_ : std::max(timeout_ms_, 2000);
+    rtt_.reset(new RttTable(targets_.size(), timeout_ms_, min_timeout_ms_, max_timeout));
+    arena_.reset();
+
+    int nworkers = (int)std::min<uint64_t>(max_threads_, total);
+
+    // never plan for more sockets than the process can open: reserve one
+    // epoll fd per reactor plus some headroom. Sockets live in the connect
+    // windows, the banner queue and the banner workers' connections.
+    int budget = fdBudget(max_in_flight_ + 2 * banner_concurrency_, nworkers + banner_threads_ + 32);
+    banner_limit_ = std::min(banner_concurrency_, std::max(1, budget / 4));
+    in_flight_limit_ = std::max(1, budget - 2 * banner_limit_);
+
+    // every reactor needs at least one slot of the in-flight window
+    nworkers = std::min(nworkers, in_flight_limit_);
+
+    active_backend_ = Backend::Epoll;
+    if (backend_ == Backend::IoUring && uringAvailable()) active_backend_ = Backend::IoUring;
+
+    {
+        std::lock_guard<std::mutex> lk(queue_mutex_);
+        banner_queue_.clear();
+        banner_queue_cap_ = (size_t)banner_limit_;
+        stop_workers_ = false;
+    }
+    int nbanner = std::min(banner_threads_, banner_limit_);
+    banner_running_ = nbanner;
+    banner_workers_.clear();
+    for (int i = 0; i < nbanner; ++i) {
+        banner_workers_.emplace_back([this, nbanner]() {
+            bannerLoop(nbanner);
+            banner_running_.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    connect_running_ = nworkers;
+    workers_.clear();
+    workers_.reserve(nworkers);
+    for (int i = 0; i < nworkers; ++i) {
+        workers_.emplace_back([this, i, nworkers]() {
+            // a ring can still fail per thread (e.g. locked memory limit):
+            // that shard then runs on epoll
+            if (active_backend_ != Backend::IoUring || !uringWorkerLoop(i, nworkers)) workerLoop(i, nworkers);
+            connect_running_.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    // this thread collects the workers' detail records while they run
+    drainUntilDone(connect_running_);
+    for (auto &t : workers_) t.join();
+    workers_.clear();
+    joinResolver();
+
+    // connect stage done: let the banner stage drain its queue and exit
+    {
+        std::lock_guard<std::mutex> lk(queue_mutex_);
+        stop_workers_ = true;
+    }
+    queue_cv_.notify_all();
+    drainUntilDone(banner_running_);
+    for (auto &t : banner_workers_) t.join();
+    banner_workers_.clear();
+    finishStream();
+}
+
+// =================== name resolution ===================
+// Hostname targets own two host slots, IPv4 and IPv6, filled in as the
+// answers arrive; the feeds pass over a slot until it is Ready or Absent.
+int Scanner::startResolver() {
+    unresolved_.clear();
+    const std::vector<std::string>& names = targets_.names();
+    if (names.empty()) return 0;
+    Resolver resolver;
+    if (!name_server_.empty() && resolver.setServer(name_server_) != 0) {
+        // nothing is pending if the scan does not start
+        for (size_t n = 0; n < names.size(); ++n) {
+            targets_.resolve(targets_.nameHost(n, AF_INET), nullptr);
+            targets_.resolve(targets_.nameHost(n, AF_INET6), nullptr);
+        }
+        return EINVAL;
+    }
+    resolver_ = std::thread([this, resolver]() mutable {
+        const std::vector<std::string>& names = targets_.names();
+        std::vector<uint8_t> missing(names.size(), 0);
+        resolver.run(names, [&](size_t name, int family, const IpAddr* addr, int) {
+            targets_.resolve(targets_.nameHost(name, family), addr);
+            if (!addr && ++missing[name] == 2) unresolved_.push_back(names[name]);
+        });
+    });
+    return 0;
+}
+
+// a scan whose every target was a name that resolved to nothing fails
+void Scanner::joinResolver() {
+    if (!resolver_.joinable()) return;
+    resolver_.join();
+    if (last_error_ == 0 && unresolved_.size() == targets_.names().size() &&
+        targets_.size() == 2 * targets_.names().size()) {
+        last_error_ = EHOSTUNREACH;
+    }
+}
+
+// =================== drainSink ===================
+// Hand whatever the workers pushed into sink_ to result_cb_ and results_;
+// returns the number of results taken. Only run()'s thread consumes the
+// ring, so the callback never runs concurrently with itself.
+//
+// In ordered mode the resolved prefix is read first: a worker queues a
+// port's record before it sets the port's state, so once the state is
+// visible the record is in the ring and this drain picks it up.
+size_t Scanner::drainSink() {
+    if (!sink_) return 0;
+    const bool ordered = result_cb_ && ordered_;
+    uint64_t upto = ordered ? reorder_.resolvedEnd(results_) : 0;
+    // same for a checkpoint: positions first, then the records
+    const bool checkpoint = !checkpoint_path_.empty() && TimingWheel::nowMs() >= next_checkpoint_ms_;
+    uint64_t swept = checkpoint ? sweptEnd() : 0;
+
+    std::vector<ScanResult> batch;
+    Resolved item;
+    size_t n = 0;
+    while (sink_->tryPop(item)) {
+        ++n;
+        if (item.stream) {
+            if (ordered) reorder_.add(results_.index(item.result.host, item.result.port), item.result);
+            else result_cb_(item.result);
+        }
+        if (item.detail) batch.push_back(std::move(item.result));
+    }
+    results_.addDetails(batch);
+
+    if (ordered) {
+        reorder_.flush(upto, results_, [this](const ScanResult& r) {
+            if (streamed(r)) result_cb_(r);
+        });
+    }
+
+    // a failed write is retried at the next interval
+    if (checkpoint) {
+        saveCheckpoint(swept);
+        next_checkpoint_ms_ = TimingWheel::nowMs() + (uint64_t)checkpoint_interval_ms_;
+    }
+    return n;
+}
+
+void Scanner::finishStream() {
+    drainSink();
+    if (!checkpoint_path_.empty()) saveCheckpoint(sweptEnd());
+    if (!result_cb_ || !ordered_) return;
+    reorder_.flush(results_.size(), results_, [this](const ScanResult& r) {
+        if (streamed(r)) result_cb_(r);
+    });
+}
+
+// =================== checkpoints ===================
+// Only the open ports are restored; closed and filtered ones before the
+// saved position stay Unscanned and are neither probed nor reported again.
+int Scanner::resumeCheckpoint() {
+    if (checkpoint_path_.empty()) return EINVAL;
+    Checkpoint cp;
+    int err = cp.load(checkpoint_path_);
+    if (err) return err;
+    const uint64_t total = results_.size();
+    if (cp.targets != targets_.fingerprint() || cp.hosts != targets_.size() ||
+        cp.first_port != start_port_ || cp.last_port != end_port_ || cp.position > total) {
+        return EINVAL;
+    }
+
+    order_seed_ = cp.seed;
+    order_ = cp.seed ? Permutation(total, cp.seed) : Permutation(total);
+    resume_pos_ = cp.position;
+
+    for (ScanResult& r : cp.open) {
+        if (r.host >= targets_.size() || r.port < start_port_ || r.port > end_port_) continue;
+        uint64_t idx = results_.index(r.host, r.port);
+        if (results_.stateAt(idx) != PortState::Unscanned) continue;
+        r.addr = targets_.address(r.host);
+        if (order_.position(idx) >= resume_pos_) ++resumed_ahead_;
+        if (streamed(r)) {
+            if (ordered_) reorder_.add(idx, r);
+            else result_cb_(r);
+        }
+        results_.set(r.host, r.port, PortState::Open);
+    }
+    results_.addDetails(cp.open);
+    return 0;
+}
+
+// first sweep position whose index is still unresolved
+uint64_t Scanner::sweptEnd() {
+    const uint64_t total = results_.size();
+    while (checkpoint_pos_ < total) {
+        uint64_t idx = order_(checkpoint_pos_);
+        if (results_.stateAt(idx) == PortState::Unscanned && !absent(idx)) break;
+        ++checkpoint_pos_;
+    }
+    return checkpoint_pos_;
+}
+
+int Scanner::saveCheckpoint(uint64_t position) {
+    Checkpoint cp;
+    cp.targets = targets_.fingerprint();
+    cp.hosts = targets_.size();
+    cp.first_port = start_port_;
+    cp.last_port = end_port_;
+    cp.seed = order_.shuffled() ? order_seed_ : 0;
+    cp.position = position;
+    cp.open = results_.details(true);
+    return cp.save(checkpoint_path_);
+}
+
+void Scanner::drainUntilDone(const std::atomic<int>& running) {
+    while (running.load(std::memory_order_acquire) > 0) {
+        if (drainSink() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(SINK_POLL_MS));
+    }
+}
+
+// =================== PortFeed ===================
+Scanner::PortFeed::Status Scanner::PortFeed::take(Probe& probe, uint64_t now_ms) {
+    if (!requeue.empty()) {
+        if (now_ms < retry_at) return WAIT;
+        probe = requeue.front();
+        requeue.pop_front();
+        return READY;
+    }
+    if (!retries.empty() && retries.top().due_ms <= now_ms) {
+        probe = retries.top().probe;
+        retries.pop();
+        return READY;
     }
+    waiting_name = false;
+    for (;;) {
+        while (next < end) {
+            uint64_t idx = order(next);
+            uint64_t host = idx / (uint64_t)nports;
+            bool wait = false;
+            if (states.stateAt(idx) != PortState::Unscanned || !admit(host, wait)) {
+                if (wait) {
+                    waiting_name = true;
+                    return WAIT;
+                }
+                next += stride;
+                continue;
+            }
+            next += stride;
+            probe = Probe{host, first_port + (int)(idx % (uint64_t)nports), 0};
+            return READY;
+        }
+        if (second_walk || !any_passed) break;
+        second_walk = true;
+        next = first;
+    }
+    return retries.empty() ? DONE : WAIT;
+}
+
+bool Scanner::PortFeed::admit(uint64_t host, bool& wait) {
+    if (passed_over.empty()) return true;
+    int64_t slot = targets.nameSlot(host);
+    if (slot < 0) return !second_walk;
+    TargetSet::HostState hs = targets.state(host);
+    if (second_walk) {
+        if (!passed_over[(size_t)slot]) return false;
+        wait = hs == TargetSet::HostState::Pending;
+        return hs == TargetSet::HostState::Ready;
+    }
+    if (passed_over[(size_t)slot] || hs == TargetSet::HostState::Pending) {
+        passed_over[(size_t)slot] = 1;
+        any_passed = true;
+        return false;
+    }
+    return hs == TargetSet::HostState::Ready;
+}
+
+bool Scanner::PortFeed::defer(const Probe& probe, bool idle, uint64_t now_ms) {
+    if (idle && backoff_ms >= BACKOFF_MAX_MS) return false;
+    requeue.push_front(probe);
+    retry_at = now_ms + backoff_ms;
+    backoff_ms = std::min(backoff_ms * 2, BACKOFF_MAX_MS);
+    return true;
+}
 
-    const int BATCH_SIZE = 500;
-    for (int batchStart = start_port_; batchStart <= end_port_; batchStart += BATCH_SIZE) {
-        int batchEnd = std::min(batchStart + BATCH_SIZE - 1, end_port_);
+int Scanner::PortFeed::waitMs(uint64_t now_ms) const {
+    uint64_t due;
+    if (!requeue.empty()) due = retry_at;
+    else if (!retries.empty()) due = retries.top().due_ms;
+    else return waiting_name ? NAME_POLL_MS : -1;
+    int ms = due > now_ms ? (int)(due - now_ms) : 0;
+    return waiting_name ? std::min(ms, NAME_POLL_MS) : ms;
+}
+
+// =================== retryDelayMs ===================
+// The first retry waits one connect timeout, later ones double it: a probe
+// lost to congestion gets a quieter moment, a filtered port costs a bounded
+// number of timeouts.
+int Scanner::retryDelayMs(int attempt, const RttEstimator* rtt) const {
+    int base = rtt ? rtt->timeoutMs() : timeout_ms_;
+    return base << std::min(attempt - 1, 4);
+}
 
-        int epfd = epoll_create1(0);
-        if (epfd < 0) {
-            freeaddrinfo(res);
+// =================== workerLoop ===================
+// One reactor per thread. Shard `shard` owns positions shard,
+// shard + nshards, ... of order_, so the workers together walk the sweep
+// order front to back and every worker gets a similar mix of hosts and of
+// low (often open/filtered) and high ports. Each result is recorded as it
+// comes in: its state goes into results_ and, if it is streamed or kept in
+// detail, it is pushed into the MPSC sink that run()'s thread drains while
+// the scan runs. Only detail records the full sink had no room for stay
+// thread-local until the shard is done.
+//
+// The worker keeps up to `window` connects in flight and refills a slot as
+// soon as any socket completes, fails or times out, so a single filtered
+// port only ever occupies one slot. Connection state lives in a Slab sized
+// to the window; the slot id doubles as epoll_event.data and as the timing
+// wheel id, so a completion is one array index and no per-port state is
+// allocated. epoll_wait sleeps exactly until the next expiry.
+// Deadlines come from the probed host's own estimator in rtt_, which every
+// SYN-ACK or RST from that host (connect success or refusal) feeds with a
+// fresh sample, so slow hosts keep their longer timeouts.
+//
+// Running out of descriptors, socket buffers or source ports
+// (EMFILE/ENFILE/ENOBUFS/ENOMEM/EADDRNOTAVAIL) says nothing about the
+// target, so those ports go back into the feed and are retried after an
+// exponential backoff instead of being reported. sources_ throttles before
+// the kernel's ephemeral ports actually run out.
+//
+// An open socket is handed to the banner stage (offerBanner). If its queue
+// is full the socket stays here, still holding its slot of the window, and
+// the handoff is retried every BANNER_POLL_MS: discovery slows down to what
+// the banner stage can absorb instead of piling up descriptors.
+//
+// A connect that times out goes back into the feed as a retry (up to
+// max_retries_ times) and is re-probed alongside the fresh ports; only the
+// last timeout is reported.
+//
+// With --rate, each connect also needs a slot from the worker's Pacer. When
+// none is free the refill stops and a timerfd (ns resolution, unlike the
+// ms epoll_wait timeout) wakes the reactor when the next one opens. A slot
+// taken when no probe is ready, or no socket could be opened, is given back.
+void Scanner::workerLoop(int shard, int nshards) {
+    std::vector<ScanResult> local;
+
+    // in_flight_limit_ is the budget for the whole scan, split across reactors
+    const int window = std::max(1, in_flight_limit_ / nshards);
+    const int nports = end_port_ - start_port_ + 1;
+    PortFeed feed(order_, results_, targets_, resume_pos_ + (uint64_t)shard, nshards, start_port_, nports);
+    TargetSet::Cursor hosts(targets_);
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) return;
+
+    const int MAX_EVENTS = 4096;
+    std::vector<struct epoll_event> events(std::min(MAX_EVENTS, window));
+
+    struct Pending {
+        int fd;
+        int source;
+        Probe probe;
+        uint64_t started_us;
+        RttEstimator* rtt;   // the host's, from rtt_
+    };
+    Slab<Pending> conns(window);
+    const uint64_t PACE_EVENT = ~0ull;   // epoll data of the pacer timerfd
+    TimingWheel wheel(TimingWheel::nowMs());
+    std::vector<int> expired;
+
+    Pacer pacer;
+    initPacer(pacer, shard, nshards);
+    int pace_fd = -1;
+    uint64_t pace_at = 0;      // refill is waiting for this slot, 0: not paced
+    uint64_t probes = 0, last_probe_ns = 0;
+    if (pacer.enabled()) {
+        pace_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = PACE_EVENT;
+        if (pace_fd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, pace_fd, &ev) < 0) {
+            if (pace_fd >= 0) close(pace_fd);
+            close(epfd);
             return;
         }
+    }
 
-        std::unordered_map<int,int> fd_to_port;
+    // no pacer slot free: sleep until `next_ns` unless already armed for it
+    auto armPace = [&](uint64_t next_ns) {
+        if (pace_at == next_ns) return;
+        struct itimerspec its {};
+        its.it_value.tv_sec = (time_t)(next_ns / 1000000000ull);
+        its.it_value.tv_nsec = (long)(next_ns % 1000000000ull);
+        timerfd_settime(pace_fd, TFD_TIMER_ABSTIME, &its, nullptr);
+        pace_at = next_ns;
+    };
+
+    // open sockets the banner queue had no room for yet; they keep their
+    // slot of the window until a later handoff succeeds
+    std::vector<OpenPort> handoff;
+    auto handOff = [&](int fd, int source, const Probe& probe) {
+        OpenPort open{fd, probe, source};
+        if (!offerBanner(open)) handoff.push_back(open);
+    };
+
+    // report slot `id` as closed/filtered and free it
+    auto finish = [&](int id, int err) {
+        Pending &p = conns[id];
+        ScanResult r;
+        r.host = p.probe.host;
+        r.port = p.probe.port;
+        r.probes = p.probe.attempt + 1;
+        r.open = false;
+        r.error_code = err;
+        record(local, r);
+        wheel.cancel(id);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, p.fd, nullptr);
+        closeProbe(p.fd, p.source);
+        conns.release(id);
+    };
+
+    // local resource shortage: hand the port back to the feed, or report it
+    // if waiting cannot help; returns true when refill() should pause
+    auto defer = [&](const Probe& probe, int err) {
+        if (feed.defer(probe, conns.empty(), TimingWheel::nowMs())) return true;
+        ScanResult r; r.host = probe.host; r.port = probe.port; r.open = false; r.error_code = err;
+        record(local, r);
+        return false;
+    };
+
+    // open sockets until the window is full or the shard is exhausted
+    auto refill = [&]() {
+        Probe probe;
+        while (conns.size() + (int)handoff.size() < window) {
+            uint64_t now_ns = Pacer::nowNs(), next_ns = 0;
+            if (pacer.take(1, now_ns, next_ns) == 0) {
+                armPace(next_ns);
+                break;
+            }
+            if (feed.take(probe, TimingWheel::nowMs()) != PortFeed::READY) {
+                pacer.refund(1);
+                break;
+            }
+            const int port = probe.port;
 
-        // Create non-blocking sockets and register
-        for (int port = batchStart; port <= batchEnd; ++port) {
-            int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            const IpAddr dst = hosts.address(probe.host);
+            int source;
+            int sockfd = probeSocket(dst.family, SOCK_NONBLOCK, source);
             if (sockfd < 0) {
-                ScanResult r; r.port = port; r.open = false; r.error_code = errno;
-                pushResult(r);
+                int err = errno;
+                pacer.refund(1);
+                if (isResourceError(err)) {
+                    if (defer(probe, err)) break;
+                    continue;
+                }
+                ScanResult r; r.host = probe.host; r.port = port; r.open = false; r.error_code = err;
+                record(local, r);
                 continue;
             }
 
-            int flags = fcntl(sockfd, F_GETFL, 0);
-            if (flags == -1) flags = 0;
-            fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
-
-            struct sockaddr_in addr = base_addr;
-            addr.sin_port = htons(port);
+            struct sockaddr_storage addr;
+            socklen_t addrlen = dst.toSockaddr((uint16_t)port, addr);
+
+            int rc = connect(sockfd, (struct sockaddr*)&addr, addrlen);
+            ++probes;
+            last_probe_ns = now_ns;
+            if (rc < 0 && errno != EINPROGRESS) {
+                int err = errno;
+                closeProbe(sockfd, source);
+                if (isResourceError(err)) {
+                    if (defer(probe, err)) break;
+                    continue;
+                }
+                ScanResult r; r.host = probe.host; r.port = port; r.open = false; r.error_code = err; r.probes = probe.attempt + 1;
+                record(local, r);
+                continue;
+            }
 
-            int rc = connect(sockfd, (struct sockaddr*)&addr, sizeof(addr));
+            // connected at once (loopback): straight to the banner stage
             if (rc == 0) {
-                ScanResult r; r.port = port; r.open = true; r.error_code = 0;
-                r.banner = tryBannerGrab(sockfd, timeout_ms_);
-                pushResult(r);
-                close(sockfd);
-                continue;
-            } else if (errno != EINPROGRESS) {
-                ScanResult r; r.port = port; r.open = false; r.error_code = errno;
-                pushResult(r);
-                close(sockfd);
+                feed.started();
+                handOff(sockfd, source, probe);
                 continue;
             }
 
+            // the window check above guarantees a free slot
+            int id = conns.alloc();
             struct epoll_event ev;
             ev.events = EPOLLOUT | EPOLLERR | EPOLLET;
-            ev.data.fd = sockfd;
+            ev.data.u64 = (uint64_t)id;
             if (epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
-                ScanResult r; r.port = port; r.open = false; r.error_code = errno;
-                pushResult(r);
-                close(sockfd);
+                int err = errno;
+                conns.release(id);
+                closeProbe(sockfd, source);
+                if (isResourceError(err)) {
+                    if (defer(probe, err)) break;
+                    continue;
+                }
+                ScanResult r; r.host = probe.host; r.port = port; r.open = false; r.error_code = err; r.probes = probe.attempt + 1;
+                record(local, r);
                 continue;
             }
-            fd_to_port[sockfd] = port;
+            feed.started();
+            RttEstimator& rtt = rtt_->forHost(probe.host, dst);
+            conns[id] = Pending{sockfd, source, probe, RttEstimator::nowUs(), &rtt};
+            wheel.schedule(id, TimingWheel::nowMs() + rtt.timeoutMs());
         }
-
-        if (fd_to_port.empty()) {
-            close(epfd);
-            continue;
+    };
+
+    int wait_err = 0;
+    refill();
+    while (!conns.empty() || feed.hasDeferred() || pace_at != 0 || !handoff.empty()) {
+        uint64_t now = TimingWheel::nowMs();
+        int wait_ms = wheel.nextTimeoutMs(now);
+        int retry_ms = feed.waitMs(now);
+        if (retry_ms >= 0) wait_ms = (wait_ms < 0) ? retry_ms : std::min(wait_ms, retry_ms);
+        if (!handoff.empty() && (wait_ms < 0 || wait_ms > BANNER_POLL_MS)) wait_ms = BANNER_POLL_MS;
+
+        int n = epoll_wait(epfd, events.data(), (int)events.size(), wait_ms);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            wait_err = errno;
+            break;
         }
 
-        const int MAX_EVENTS = 4096;
-        std::vector<struct epoll_event> events(MAX_EVENTS);
+        for (int i = 0; i < n; ++i) {
+            uint64_t data = events[i].data.u64;
+            if (data == PACE_EVENT) {
+                uint64_t ticks;
+                ssize_t rd = read(pace_fd, &ticks, sizeof(ticks));
+                (void)rd;
+                pace_at = 0;
+                continue;
+            }
+            int id = (int)data;
+            if (!conns.live(id)) continue;
+            Pending &p = conns[id];
 
-        while (!fd_to_port.empty()) {
-            int n = epoll_wait(epfd, events.data(), (int)events.size(), timeout_ms_);
-            if (n < 0) {
-                if (errno == EINTR) continue;
-                break;
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            if (getsockopt(p.fd, SOL_SOCKET, SO_ERROR, &so_error, &len) < 0) so_error = errno;
+
+            // the host answered (SYN-ACK or RST): one RTT sample
+            if (so_error == 0 || so_error == ECONNREFUSED) {
+                p.rtt->sample(RttEstimator::nowUs() - p.started_us);
             }
-            if (n == 0) {
-                for (auto &p : fd_to_port) {
-                    ScanResult r; r.port = p.second; r.open = false; r.error_code = ETIMEDOUT;
-                    pushResult(r);
-                    close(p.first);
-                }
-                fd_to_port.clear();
-                break;
+
+            if (so_error == 0) {
+                wheel.cancel(id);
+                epoll_ctl(epfd, EPOLL_CTL_DEL, p.fd, nullptr);
+                handOff(p.fd, p.source, p.probe);
+                conns.release(id);
+                continue;
             }
 
-            for (int i = 0; i < n; ++i) {
-                int fd = events[i].data.fd;
-                auto it = fd_to_port.find(fd);
-                if (it == fd_to_port.end()) {
-                    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
-                    close(fd);
-                    continue;
-                }
-                int port = it->second;
-
-                int so_error = 0;
-                socklen_t len = sizeof(so_error);
-                if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len) < 0) so_error = errno;
-
-                ScanResult r;
-                r.port = port;
-                r.open = (so_error == 0);
-                if (r.open) {
-                    r.banner = tryBannerGrab(fd, timeout_ms_);
-                } else {
-                    r.error_code = so_error;
-                }
-                pushResult(r);
+            finish(id, so_error);
+        }
 
-                epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
-                close(fd);
-                fd_to_port.erase(it);
+        // reclaim sockets whose own deadline has passed
+        expired.clear();
+        uint64_t now_ms = TimingWheel::nowMs();
+        wheel.advance(now_ms, expired);
+        for (int id : expired) {
+            if (!conns.live(id)) continue;
+            Pending &p = conns[id];
+            if (p.probe.attempt < max_retries_) {
+                Probe probe{p.probe.host, p.probe.port, p.probe.attempt + 1};
+                epoll_ctl(epfd, EPOLL_CTL_DEL, p.fd, nullptr);
+                closeProbe(p.fd, p.source);
+                conns.release(id);
+                feed.retry(probe, now_ms + retryDelayMs(probe.attempt, p.rtt));
+                continue;
             }
+            finish(id, ETIMEDOUT);
         }
 
-        close(epfd);
-    }
+        // retry sockets the banner queue had no room for
+        size_t kept = 0;
+        for (const OpenPort& open : handoff) {
+            if (!offerBanner(open)) handoff[kept++] = open;
+        }
+        handoff.resize(kept);
 
-    freeaddrinfo(res);
-}
+        refill();
+    }
 
+    // epoll_wait failed hard: don't leak what is still registered
+    conns.forEach([&](int, Pending& p) {
+        ScanResult r; r.host = p.probe.host; r.port = p.probe.port; r.open = false; r.error_code = wait_err;
+        record(local, r);
+        closeProbe(p.fd, p.source);
+    });
+    for (const Probe& probe : feed.requeue) {
+        ScanResult r; r.host = probe.host; r.port = probe.port; r.open = false; r.error_code = wait_err;
+        record(local, r);
+    }
+    for (const OpenPort& open : handoff) {
+        ScanResult r; r.host = open.probe.host; r.port = open.probe.port; r.open = true; r.probes = open.probe.attempt + 1;
+        record(local, r);
+        closeProbe(open.fd, open.source);
+    }
+    for (; !feed.retries.empty(); feed.retries.pop()) {
+        const Probe& probe = feed.retries.top().probe;
+        ScanResult r; r.host = probe.host; r.port = probe.port; r.open = false; r.error_code = wait_err;
+        record(local, r);
+    }
 
-    // // final cleanup
-    // for (int fd : fds_to_close) {
-    //     // if still open (in case not removed), try to close
-    //     // but we already closed in loop, so ignore errors
-    //     // close(fd);
-    //     (void)fd;
-    // }
-    // close(epfd);
-    // freeaddrinfo(res);
+    if (pace_fd >= 0) close(pace_fd);
+    close(epfd);
+    countProbes(probes, last_probe_ns);
+    mergeResults(local);
+}
 
 
 std::vector<ScanResult> Scanner::getResults() {
-    std::lock_guard<std::mutex> lk(results_mutex_);
-    return results_;
+    return results_.materialize(false);
+}
+
+std::vector<ScanResult> Scanner::getOpenResults() {
+    return results_.materialize(true);
 }
 
 
 std::string Scanner::resultsToTextOpenOnly() {
-    std::lock_guard<std::mutex> lk(results_mutex_);
     std::ostringstream oss;
-    for (const auto &r : results_) {
+    for (const auto &r : results_.materialize(true)) {
         if (r.open) {  // only open ports
             oss << "[+] port:   " << r.port << "        status:      open";
             oss << "\n";
@@ -181,130 +840,91 @@ std::string Scanner::resultsToTextOpenOnly() {
     return oss.str();
 }
 
+// =================== bannerWaitMs ===================
+// a probe's own wait plus the path's connect timeout, so slow links still
+// get a full reply window
+int Scanner::bannerWaitMs(const ServiceProbe& probe, const RttEstimator* rtt) const {
+    return probe.wait_ms + (rtt ? rtt->timeoutMs() : timeout_ms_);
+}
 
+// =================== isResourceError ===================
+// errors caused by our own process/kernel running short, not by the target
+bool Scanner::isResourceError(int err) {
+    return err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM || err == EADDRNOTAVAIL;
+}
 
-
-// =================== connectWithTimeout ===================
-// returns sockfd >=0 on success (socket is blocking when returned)
-// or -1 on failure and err set to errno
-int Scanner::connectWithTimeout(const struct addrinfo* addr, int timeout_ms, int &err) {
-    int sockfd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
-    if (sockfd < 0) {
-        err = errno;
-        return -1;
-    }
-
-    // set non-blocking
-    int flags = fcntl(sockfd, F_GETFL, 0);
-    if (flags == -1) flags = 0;
-    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
-
-    int rc = connect(sockfd, addr->ai_addr, addr->ai_addrlen);
-    if (rc == 0) {
-        // connected immediately
-        // restore flags to blocking
-        fcntl(sockfd, F_SETFL, flags);
-        return sockfd;
-    } else if (errno != EINPROGRESS) {
-        // immediate error
-        err = errno;
-        close(sockfd);
-        return -1;
-    }
-
-    // wait for writable with timeout
-    fd_set wfds;
-    FD_ZERO(&wfds);
-    FD_SET(sockfd, &wfds);
-    struct timeval tv;
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-    int sel = select(sockfd + 1, nullptr, &wfds, nullptr, &tv);
-    if (sel <= 0) {
-        // timeout or select error
-        if (sel == 0) err = ETIMEDOUT;
-        else err = errno;
-        close(sockfd);
+// =================== probeSocket ===================
+// SO_LINGER 0 makes close() send a RST instead of a FIN: an open port that
+// was probed never leaves a TIME_WAIT socket sitting on its source port.
+int Scanner::probeSocket(int family, int flags, int& source) {
+    int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC | flags, 0);
+    if (fd < 0) return -1;
+    struct linger lg = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    source = sources_.acquire(fd, family);
+    if (source < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
         return -1;
     }
+    return fd;
+}
 
-    // check socket error
-    int so_error = 0;
-    socklen_t len = sizeof(so_error);
-    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &so_error, &len) < 0) {
-        err = errno;
-        close(sockfd);
-        return -1;
-    }
-    if (so_error != 0) {
-        err = so_error;
-        close(sockfd);
-        return -1;
-    }
+void Scanner::closeProbe(int fd, int source) {
+    close(fd);
+    sources_.release(source);
+}
 
-    // connected; restore blocking mode
-    fcntl(sockfd, F_SETFL, flags);
-    return sockfd;
-}
-
-// =================== tryBannerGrab ===================
-std::string Scanner::tryBannerGrab(int sockfd, int timeout_ms) {
-    // simple banner grab rules:
-    // - for HTTP-like ports: send HEAD and read response
-    // - for others: attempt to recv (many services send initial banner like SSH)
-    std::string out;
-    // set small recv timeout via select
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(sockfd, &rfds);
-    struct timeval tv;
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-    // Attempt to identify by port? We don't have port here; upper level could pass port if needed.
-    // We'll attempt a non-blocking recv first (some servers send banner).
-    int sel = select(sockfd + 1, &rfds, nullptr, nullptr, &tv);
-    if (sel > 0 && FD_ISSET(sockfd, &rfds)) {
-        char buf[1024];
-        ssize_t n = recv(sockfd, buf, sizeof(buf) - 1, 0);
-        if (n > 0) {
-            buf[n] = '\0';
-            out.assign(buf, buf + n);
-            // trim CRLFs
-            while (!out.empty() && (out.back() == '\n' || out.back() == '\r')) out.pop_back();
-            return out;
-        }
-    }
+// =================== pushResult ===================
+void Scanner::pushResult(const ScanResult& r) {
+    std::vector<ScanResult> one;
+    record(one, r);
+    results_.addDetails(one);
+}
 
-    // If nothing received, try a very small write/read for HTTP-like behavior:
-    const char *httpReq = "HEAD / HTTP/1.0\r\n\r\n";
-    send(sockfd, httpReq, strlen(httpReq), 0);
-
-    // wait again for response
-    FD_ZERO(&rfds);
-    FD_SET(sockfd, &rfds);
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-    sel = select(sockfd + 1, &rfds, nullptr, nullptr, &tv);
-    if (sel > 0 && FD_ISSET(sockfd, &rfds)) {
-        char buf[2048];
-        ssize_t n = recv(sockfd, buf, sizeof(buf) - 1, 0);
-        if (n > 0) {
-            buf[n] = '\0';
-            out.assign(buf, buf + n);
-            while (!out.empty() && (out.back() == '\n' || out.back() == '\r')) out.pop_back();
-            return out;
+// =================== record ===================
+// The port's state goes straight into results_ (lock-free). A result that
+// says more than its state goes through sink_, also lock-free, as a detail
+// record and/or for the stream. In ordered mode a plain result is streamed
+// from its state alone and skips the ring. With checkpoints on, every open
+// port becomes a detail record, since the checkpoint lists them.
+//
+// A full ring parks a detail record in `local` for mergeResults(); a
+// streamed or checkpointed result waits for room instead, so the stream
+// stays live, a checkpoint never misses an open port whose state it covers,
+// and memory stays bounded (run()'s own thread drains the ring itself
+// meanwhile). Either way the state is set last, see drainSink().
+void Scanner::record(std::vector<ScanResult>& local, ScanResult r) {
+    const uint64_t host = r.host;
+    const int port = r.port;
+    r.addr = targets_.address(host);
+    const PortState state = ResultStore::stateOf(r);
+    bool plain = results_.implies(r);
+    bool saved = r.open && !checkpoint_path_.empty();
+    bool detail = (!plain && keep_results_) || saved;
+    bool stream = streamed(r) && !(ordered_ && plain);
+
+    if (detail || stream) {
+        Resolved item{std::move(r), detail, stream};
+        if (!sink_) {
+            if (detail) local.push_back(std::move(item.result));
+        } else if (!stream && !saved) {
+            if (!sink_->tryPush(item)) local.push_back(std::move(item.result));
+        } else {
+            while (!sink_->tryPush(item)) {
+                if (std::this_thread::get_id() == sink_consumer_) drainSink();
+                else std::this_thread::yield();
+            }
         }
     }
-
-    return out; // empty if not obtained
+    results_.set(host, port, state);
 }
 
-// =================== pushResult ===================
-void Scanner::pushResult(const ScanResult& r) {
-    std::lock_guard<std::mutex> lk(results_mutex_);
-    results_.push_back(r);
+// =================== mergeResults ===================
+// records the sink had no room for: one lock per worker, not per port
+void Scanner::mergeResults(std::vector<ScanResult>& local) {
+    results_.addDetails(local);
 }
 
 
@@ -1,12 +1,17 @@
 #ifndef SCANNER_H
 #define SCANNER_H
 #pragma once
+#include <atomic>
 #include <unordered_map>
+#include <deque>
+#include <queue>
+#include <memory>
 #include <string>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -18,38 +23,151 @@
 #include <sstream>
 #include <chrono>
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
 #include <errno.h>
+#include "arena.h"
+#include "checkpoint.h"
+#include "mpsc_ring.h"
+#include "pacer.h"
+#include "permutation.h"
+#include "probes.h"
+#include "reorder_buffer.h"
+#include "resolver.h"
+#include "result_store.h"
+#include "rtt.h"
+#include "slab.h"
+#include "source_pool.h"
+#include "targets.h"
+#include "timing_wheel.h"
 
 
-struct ScanResult {
-    int port = 0;
-    bool open = false;
-    std::string banner;   // optional
-    int error_code = 0;   // errno-like
+enum class Backend {
+    Epoll,     // one epoll reactor per worker (default, always available)
+    IoUring,   // batched io_uring submissions; falls back to Epoll if unsupported
+};
+
+enum class ScanType {
+    Connect,   // full TCP connect() per port (default, unprivileged)
+    Syn,       // raw half-open SYN probes, needs CAP_NET_RAW
+};
+
+// receives results as the scan resolves them, see Scanner::setResultCallback
+using ResultCallback = std::function<void(const ScanResult&)>;
+
+struct RateStats {
+    double target = 0;     // probes/s set with setRate(), 0: unlimited
+    double observed = 0;   // probes/s actually sent by the last run()
+    uint64_t probes = 0;   // connects / SYNs sent by the last run()
 };
 
 class Scanner {
 public:
-    // target: hostname or IP, start/end ports inclusive
+    // target: hostname, IP, CIDR block or range, or a comma-separated list
+    // of them (see TargetSet); start/end ports inclusive
     // threads: number of worker threads
     // timeout_ms: connect timeout in milliseconds
     Scanner(const std::string& target, int start_port, int end_port,
             int threads = 100, int timeout_ms = 500);
 
+    // more hosts to scan, same syntax as `target`; 0 or errno (the scan
+    // also fails with it, see lastError())
+    int addTargets(const std::string& specs);
+    // hosts listed in a file, see TargetSet::addFile()
+    int addTargetFile(const std::string& path);
+    const TargetSet& targets() const { return targets_; }
+
+    // DNS server ("ip" or "ip:port") for hostname targets instead of the
+    // one in /etc/resolv.conf; run() fails with EINVAL if it is malformed
+    void setNameServer(const std::string& server);
+    // hostnames of the last run() that resolved to no address at all
+    std::vector<std::string> unresolvedTargets() const { return unresolved_; }
+
+    // local addresses connect probes are spread across ("ip,ip,...", both
+    // families allowed); 0 or EINVAL. run() fails with EADDRNOTAVAIL if one
+    // cannot be bound.
+    int addSourceAddresses(const std::string& addrs);
+
     // run scan and block until finished
     void run();
 
-    // Get results (thread-safe after run finished)
+    // Get results (thread-safe after run finished), by host, then port.
+    // Results are stored compactly (ResultStore); these build full records.
     std::vector<ScanResult> getResults();
+    std::vector<ScanResult> getOpenResults();
 
     // Optional: produce simple JSON string of results
     std::string resultsToText(); // IGNORE
 
     std::string resultsToTextOpenOnly(); 
 
-    void scanBatch(int batchStart, int batchEnd ); // new method to scan a batch of ports
+    // max number of connects in flight across all workers (default 500)
+    void setMaxInFlight(int n);
+
+    // I/O engine used by the workers (default Backend::Epoll)
+    void setBackend(Backend b);
+    // engine actually used by the last run() (IoUring may fall back)
+    Backend activeBackend() const { return active_backend_; }
+
+    // probe technique (default ScanType::Connect)
+    void setScanType(ScanType t);
+
+    // bounds for the RTT-derived connect timeout; timeout_ms is only the
+    // value used before the first RTT sample. Defaults: 50 ms and
+    // max(timeout_ms, 2000 ms)
+    void setTimeoutBounds(int min_ms, int max_ms);
+
+    // pace probes (connects or SYNs) to `per_sec` across all workers,
+    // spread evenly in time; 0 = unlimited (default)
+    void setRate(double per_sec);
+    // target vs. observed send rate of the last run()
+    RateStats rateStats() const;
+
+    // re-probe a port that timed out up to n more times, with exponential
+    // backoff, before reporting it as filtered (default 1). Refused or
+    // unreachable ports are never retried. At most MAX_RETRIES.
+    void setRetries(int n);
+    static constexpr int MAX_RETRIES = 16;
+
+    // banner stage: `threads` workers interrogate open ports with up to
+    // `concurrency` connections in total, spending at most `timeout_ms` per
+    // port (defaults 2, 256, 3000)
+    void setBannerStage(int threads, int concurrency, int timeout_ms);
+
+    // stream results while run() is going: `cb` is called on run()'s thread
+    // as ports resolve (an open port once its banner is in).
+    // open_only: skip closed and filtered ports.
+    // ordered: deliver in port order, each port as soon as every port below
+    // it has resolved; otherwise in the order they resolve.
+    void setResultCallback(ResultCallback cb, bool open_only = true, bool ordered = true);
+
+    // probe order: shuffled over all hosts and ports (default), or
+    // sequential, host by host in port order. `seed` fixes the shuffle
+    // (0: a fresh random one per run())
+    void setShuffle(bool shuffle, uint64_t seed = 0);
+    // seed of the last run()'s shuffle, 0 if it was sequential
+    uint64_t shuffleSeed() const { return order_.shuffled() ? order_seed_ : 0; }
+
+    // write a Checkpoint to `path` every `interval_ms` while run() is going
+    // and once more at its end (empty path: off, the default). run() fails
+    // with errno if the file cannot be written.
+    void setCheckpoint(const std::string& path, int interval_ms = 10000);
+    // continue the sweep saved in the checkpoint file instead of starting
+    // over: its seed replaces setShuffle()'s, finished positions are
+    // skipped and its open ports are reported again. run() fails with
+    // EINVAL if the checkpoint belongs to other targets or ports.
+    void setResume(bool resume);
+
+    // keep detail records for getResults() (default true); a caller that
+    // streams a huge scan can turn this off to keep memory flat
+    void setKeepResults(bool keep);
+
+    // errno of a setup failure that aborted the last run() (e.g. EPERM for a
+    // SYN scan without CAP_NET_RAW), 0 if it ran
+    int lastError() const { return last_error_; }
 
     
 private:
@@ -58,31 +176,269 @@ private:
     int end_port_;
     int max_threads_;
     int timeout_ms_;
+    int min_timeout_ms_ = 50;
+    int max_timeout_ms_ = 0;    // 0: derived from timeout_ms_
+    int max_in_flight_ = 500;
+    int in_flight_limit_ = 500; // max_in_flight_ capped by RLIMIT_NOFILE in run()
+    SourcePool sources_;        // local addresses and their port budgets
+    int max_retries_ = 1;
+    int banner_threads_ = 2;
+    int banner_concurrency_ = 256;
+    int banner_timeout_ms_ = 3000;
+    int banner_limit_ = 256;    // banner_concurrency_ capped by RLIMIT_NOFILE in run()
+    Backend backend_ = Backend::Epoll;
+    Backend active_backend_ = Backend::Epoll;
+    ScanType scan_type_ = ScanType::Connect;
+    int last_error_ = 0;
+
+    // --rate pacing: every worker gets rate_ / nworkers, phase-shifted so
+    // the merged stream is evenly spaced
+    double rate_ = 0;
+    uint64_t pace_start_ns_ = 0;
+    std::atomic<uint64_t> probes_sent_{0};
+    std::atomic<uint64_t> last_probe_ns_{0};
+
+    // hosts to scan, expanded lazily: workers map a host number to its
+    // address with a TargetSet::Cursor. Hostnames are resolved by a
+    // Resolver on resolver_ while the scan runs (see startResolver()).
+    TargetSet targets_;
+    int target_error_ = 0;      // first failed addTargets()/addTargetFile()
+    std::string name_server_;
+    std::thread resolver_;
+    std::vector<std::string> unresolved_;   // written by resolver_
+
+    // order in which run() visits the (host, port) indexes: position k of
+    // the sweep probes index order_(k)
+    bool shuffle_ = true;
+    uint64_t seed_ = 0;         // 0: random per run()
+    uint64_t order_seed_ = 0;
+    Permutation order_;
+
+    // checkpoints: run()'s thread advances checkpoint_pos_ over the sweep
+    // positions whose state is known and saves it with the open ports
+    std::string checkpoint_path_;
+    int checkpoint_interval_ms_ = 10000;
+    bool resume_ = false;
+    uint64_t resume_pos_ = 0;       // positions below were done by an earlier run
+    uint64_t resumed_ahead_ = 0;    // restored open ports at or after resume_pos_
+    uint64_t checkpoint_pos_ = 0;
+    uint64_t next_checkpoint_ms_ = 0;
+
+    // connect RTT / timeout estimates per host, shared by all workers
+    std::unique_ptr<RttTable> rtt_;
 
-    std::vector<ScanResult> results_;
-    std::mutex results_mutex_;
+    // scan-lifetime memory (banner receive buffers); reset by run(), its
+    // blocks are reused by the next scan
+    Arena arena_;
+
+    // port states + detail records of the last run()
+    ResultStore results_;
+
+    // result on its way from a worker to run()'s thread: a detail record
+    // for results_, a result to stream, or both
+    struct Resolved {
+        ScanResult result;
+        bool detail = false;
+        bool stream = false;
+    };
+
+    // workers push resolved ports here without locking; run()'s thread
+    // drains them into results_ and result_cb_ while the scan is going
+    std::unique_ptr<MpscRing<Resolved>> sink_;
+    std::thread::id sink_consumer_;
+    static constexpr size_t SINK_CAPACITY = 4096;
+    static constexpr int SINK_POLL_MS = 1;
+    std::atomic<int> connect_running_{0};
+    std::atomic<int> banner_running_{0};
+
+    ResultCallback result_cb_;
+    bool stream_all_ = false;     // result_cb_ also gets closed/filtered ports
+    bool ordered_ = true;         // result_cb_ sees ports in port order
+    bool keep_results_ = true;
+    ReorderBuffer reorder_;       // ordered_: ports waiting for lower ones
+
+    // One probe of host:port; attempt 0 is the first, retries count up.
+    struct Probe {
+        uint64_t host;   // number in targets_
+        int port;
+        int attempt;
+    };
+
+    // connected socket on its way from the connect stage to the banner stage
+    struct OpenPort {
+        int fd;
+        Probe probe;
+        int source;      // sources_ entry holding the socket's port
+    };
 
     // Thread-pool + task queue
+    // workers_ holds one connect reactor per thread while run() is active,
+    // banner_workers_ the banner stage. banner_queue_ links the two stages
+    // and holds at most banner_queue_cap_ sockets; queue_cv_ wakes idle
+    // banner workers, stop_workers_ tells them the connect stage is done.
     std::vector<std::thread> workers_;
-    std::vector<int> ports_queue_;
+    std::vector<std::thread> banner_workers_;
+    std::deque<OpenPort> banner_queue_;
+    size_t banner_queue_cap_ = 0;
     std::mutex queue_mutex_;
     std::condition_variable queue_cv_;
     bool stop_workers_ = false;
 
-    // worker loop
-    void workerLoop();
+    // Per-worker source of probes: the shard's own sequence of (host, port)
+    // indexes, ports that were put back after a local resource error and
+    // wait out a backoff, and timed-out ports waiting for their retry. Due
+    // retries go out before fresh ports, so they are interleaved with the
+    // sweep instead of forming a second pass.
+    //
+    // Indexes run host-major over every host of targets_ and ports
+    // first_port.. (nports of them). The feed walks positions of `order`
+    // and only keeps its own, so no host list or visited set is ever built;
+    // indexes already resolved in `states` (restored by a resume) are
+    // skipped.
+    //
+    // A hostname's host whose address is not known yet is passed over for
+    // the rest of the walk (its ports too, even once it resolves, so none
+    // can be taken twice); a second walk then visits just those hosts'
+    // ports, waiting for names still unresolved. Hosts a name turned out
+    // not to have are skipped.
+    struct PortFeed {
+        enum Status { READY, WAIT, DONE };
+
+        PortFeed(const Permutation& order, const ResultStore& states, const TargetSet& targets,
+                 uint64_t first, int stride, int first_port, int nports)
+            : order(order), states(states), targets(targets), first(first), next(first),
+              end(order.size()), stride(stride), first_port(first_port), nports(nports),
+              passed_over(2 * targets.names().size(), 0) {}
+
+        // READY: `probe` is the next one to send; WAIT: only deferred ports
+        // or retries are left and none is due yet; DONE: shard exhausted
+        Status take(Probe& probe, uint64_t now_ms);
+        // put `probe` back after EMFILE & co.; returns false (report the
+        // error instead) when nothing is in flight and backoff is maxed out
+        bool defer(const Probe& probe, bool idle, uint64_t now_ms);
+        // send `probe` (already counting the retry) again at due_ms
+        void retry(const Probe& probe, uint64_t due_ms) { retries.push(Retry{due_ms, probe}); }
+        // a socket was opened successfully: reset the backoff
+        void started() { backoff_ms = BACKOFF_MIN_MS; }
+        // ms until a deferred port or retry is due, -1 if none is waiting
+        int waitMs(uint64_t now_ms) const;
+        bool hasDeferred() const { return !requeue.empty() || !retries.empty() || waiting_name; }
+
+        static constexpr int BACKOFF_MIN_MS = 10;
+        static constexpr int BACKOFF_MAX_MS = 1000;
+        static constexpr int NAME_POLL_MS = 10;
+
+        struct Retry {
+            uint64_t due_ms;
+            Probe probe;
+            bool operator>(const Retry& o) const { return due_ms > o.due_ms; }
+        };
+
+        const Permutation& order;
+        const ResultStore& states;
+        const TargetSet& targets;
+        uint64_t first;
+        uint64_t next;
+        uint64_t end;
+        int stride;
+        int first_port;
+        int nports;
+        std::deque<Probe> requeue;
+        int backoff_ms = BACKOFF_MIN_MS;
+        uint64_t retry_at = 0;
+        std::priority_queue<Retry, std::vector<Retry>, std::greater<Retry>> retries;
+        std::vector<uint8_t> passed_over;   // per TargetSet::nameSlot()
+        bool second_walk = false;
+        bool any_passed = false;
+        bool waiting_name = false;
+
+        // false if the index must not be taken now; `wait` when the walk
+        // has to stop at it until its name resolves
+        bool admit(uint64_t host, bool& wait);
+    };
 
-    // scan single port (core logic)
-    ScanResult scanPort(int port);
+    // delay before retry number `attempt` (1-based) of a timed-out port to
+    // the host `rtt` measures (nullptr: the -o timeout)
+    int retryDelayMs(int attempt, const RttEstimator* rtt) const;
 
-    // helper: non-blocking connect with timeout (returns socket fd >=0 on success, or -1 on failure and sets err)
-    int connectWithTimeout(const struct addrinfo* addr, int timeout_ms, int &err);
+    // worker loop: scans every nshards-th position of order_ starting at shard
+    void workerLoop(int shard, int nshards);
 
-    // helper: try to read banner with recv + select timeout
-    std::string tryBannerGrab(int sockfd, int timeout_ms);
+    // same contract as workerLoop, driven by io_uring (scanner_uring.cpp);
+    // returns false without scanning anything if no ring could be set up
+    bool uringWorkerLoop(int shard, int nshards);
 
-    // push result into results_ with mutex
+    // probe the kernel once per run() before choosing Backend::IoUring
+    static bool uringAvailable();
+
+    // this worker's share of rate_, first slot offset by `shard` intervals
+    void initPacer(Pacer& pacer, int shard, int nshards) const;
+    // account a worker's probes for rateStats()
+    void countProbes(uint64_t n, uint64_t last_ns);
+
+    // ScanType::Syn: raw SYN sender + reply receiver (scanner_syn.cpp)
+    void runSyn();
+
+    // how long to wait for the reply to one banner probe from the host
+    // `rtt` measures
+    int bannerWaitMs(const ServiceProbe& probe, const RttEstimator* rtt) const;
+
+    // banner stage (scanner_banner.cpp): queue an open socket without
+    // blocking; false when the queue is full (keep it and retry later)
+    bool offerBanner(const OpenPort& open);
+    // one of `nworkers` banner stage workers
+    void bannerLoop(int nworkers);
+    // how often a busy banner worker looks for queued sockets, and how often
+    // a connect worker retries handing off to a full queue
+    static constexpr int BANNER_POLL_MS = 5;
+    // receive buffer per banner connection, carved from arena_
+    static constexpr size_t BANNER_BUF = 2048;
+
+    // true for EMFILE/ENFILE/ENOBUFS/ENOMEM/EADDRNOTAVAIL: retry later,
+    // don't report
+    static bool isResourceError(int err);
+
+    // socket for a connect probe to `family`: bound to a source with ports
+    // left (returned in `source`) and reset on close, so no TIME_WAIT is
+    // left behind; -1 with errno set
+    int probeSocket(int family, int flags, int& source);
+    void closeProbe(int fd, int source);
+
+    // record a single result (lock-free, see record())
     void pushResult(const ScanResult& r);
+
+    // note r's port state in results_ and pass r on to sink_ if it needs
+    // a detail record or is streamed; `local` is the fallback when the ring
+    // is full
+    void record(std::vector<ScanResult>& local, ScanResult r);
+    bool streamed(const ScanResult& r) const { return result_cb_ && (stream_all_ || r.open); }
+
+    // move a worker's thread-local detail records into results_ under one lock
+    void mergeResults(std::vector<ScanResult>& local);
+
+    // consumer side of sink_ (run()'s thread only)
+    size_t drainSink();
+    // drain sink_ until `running` workers are all done
+    void drainUntilDone(const std::atomic<int>& running);
+    // last drain of a run(): flush whatever the reorder buffer still holds
+    void finishStream();
+
+    // checkpoints (run()'s thread): restore the saved sweep before workers
+    // start, advance checkpoint_pos_, write the file; 0 or errno
+    int resumeCheckpoint();
+    uint64_t sweptEnd();
+    int saveCheckpoint(uint64_t position);
+
+    // hostname targets: resolve them on resolver_ while the sweep starts;
+    // 0 or EINVAL for a bad setNameServer()
+    int startResolver();
+    void joinResolver();
+    // index of a host a name turned out not to have: never probed, and
+    // counted as resolved by the stream and checkpoints
+    bool absent(uint64_t idx) const {
+        return !targets_.names().empty() &&
+               targets_.state(idx / (uint64_t)(end_port_ - start_port_ + 1)) == TargetSet::HostState::Absent;
+    }
 };
 
 #endif // SCANNER_H
@@ -0,0 +1,206 @@
+#include "scanner.h"
+
+using namespace std;
+
+// =================== offerBanner ===================
+// Connect workers hand open sockets over here. Never blocks: a full queue
+// returns false and the caller keeps the socket, and its slot of the connect
+// window, until a later attempt succeeds. That is the backpressure that keeps
+// discovery from running arbitrarily far ahead of interrogation.
+bool Scanner::offerBanner(const OpenPort& open) {
+    {
+        std::lock_guard<std::mutex> lk(queue_mutex_);
+        if (banner_queue_.size() >= banner_queue_cap_) return false;
+        banner_queue_.push_back(open);
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+// =================== bannerLoop ===================
+// Banner stage worker: its own epoll reactor holding up to
+// banner_limit_ / nworkers connections. Each connection walks the
+// port's probe plan (probes.h) one step at a time: send the step's payload,
+// if any, and wait for a reply until the step's deadline on the wheel. All
+// steps together get at most banner_timeout_ms_.
+//
+// Connections live in a Slab indexed by the id in epoll_event.data, each
+// with a BANNER_BUF receive buffer carved from arena_ when the worker
+// starts, so a banner costs no allocation until its result is built. A
+// reply is read until the socket runs dry or the buffer is full, which
+// keeps banners that arrive in several segments whole.
+//
+// An idle worker sleeps on queue_cv_; a busy one with free capacity also
+// checks the queue every BANNER_POLL_MS. Workers exit once the connect stage
+// is done (stop_workers_) and the queue is drained. A worker whose reactor
+// fails keeps draining the queue, reporting the ports without a banner, so
+// the connect stage can never wedge on a full queue.
+void Scanner::bannerLoop(int nworkers) {
+    std::vector<ScanResult> local;
+    const int window = std::max(1, banner_limit_ / nworkers);
+
+    // open port that gets no banner
+    auto bare = [&](const Probe& probe) {
+        ScanResult r;
+        r.host = probe.host;
+        r.port = probe.port;
+        r.probes = probe.attempt + 1;
+        r.open = true;
+        record(local, std::move(r));
+    };
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<struct epoll_event> events(std::min(window, 1024));
+
+    struct Conn {
+        int fd;
+        int source;             // sources_ entry, released on close
+        Probe probe;
+        const RttEstimator* rtt;   // the host's, from rtt_
+        int step;               // index into the port's ProbePlan
+        uint64_t deadline_ms;   // end of the whole banner grab
+        char* buf;              // BANNER_BUF bytes from arena_
+        size_t len;             // bytes received for the current step
+    };
+    Slab<Conn> conns(window);
+    char* bufs = arena_.alloc((size_t)window * BANNER_BUF);
+    for (int id = 0; id < window; ++id) conns[id].buf = bufs + (size_t)id * BANNER_BUF;
+    TimingWheel wheel(TimingWheel::nowMs());
+    std::vector<int> expired;
+    std::vector<OpenPort> taken;
+
+    // report slot `id` with whatever the current step received, free it
+    auto finish = [&](int id) {
+        Conn &c = conns[id];
+        ScanResult r;
+        r.host = c.probe.host;
+        r.port = c.probe.port;
+        r.probes = c.probe.attempt + 1;
+        r.open = true;
+        if (c.len > 0) r.banner = probePlanFor(c.probe.port).steps[c.step]->banner(c.buf, c.len);
+        record(local, std::move(r));
+        wheel.cancel(id);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd, nullptr);
+        closeProbe(c.fd, c.source);
+        conns.release(id);
+    };
+
+    // start step c.step of the port's probe plan: send its payload and arm
+    // its wait. Returns false once the plan or the time is used up (port
+    // reported without a banner, slot freed).
+    auto nextProbe = [&](int id) {
+        Conn &c = conns[id];
+        const ProbePlan& plan = probePlanFor(c.probe.port);
+        uint64_t now = TimingWheel::nowMs();
+        c.len = 0;
+        for (; c.step < plan.count && now < c.deadline_ms; ++c.step) {
+            const ServiceProbe& sp = *plan.steps[c.step];
+            if (sp.payload && send(c.fd, sp.payload, sp.len, MSG_NOSIGNAL) != (ssize_t)sp.len) continue;
+            wheel.schedule(id, std::min(now + bannerWaitMs(sp, c.rtt), c.deadline_ms));
+            return true;
+        }
+        finish(id);
+        return false;
+    };
+
+    // slot `id` is readable (or hung up): drain it into its buffer and
+    // report once something arrived or the peer is gone
+    auto readable = [&](int id) {
+        Conn &c = conns[id];
+        bool eof = false;
+        while (c.len < BANNER_BUF - 1) {
+            ssize_t n = recv(c.fd, c.buf + c.len, BANNER_BUF - 1 - c.len, 0);
+            if (n > 0) {
+                c.len += (size_t)n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            eof = (n == 0 || errno != EAGAIN);
+            break;
+        }
+        if (c.len > 0 || eof) finish(id);
+    };
+
+    while (epfd >= 0) {
+        taken.clear();
+        {
+            std::unique_lock<std::mutex> lk(queue_mutex_);
+            if (conns.empty()) {
+                queue_cv_.wait(lk, [&]() { return !banner_queue_.empty() || stop_workers_; });
+            }
+            while (conns.size() + (int)taken.size() < window && !banner_queue_.empty()) {
+                taken.push_back(banner_queue_.front());
+                banner_queue_.pop_front();
+            }
+            if (conns.empty() && taken.empty() && stop_workers_) break;
+        }
+
+        uint64_t now = TimingWheel::nowMs();
+        for (const OpenPort& op : taken) {
+            int id = conns.alloc();
+            struct epoll_event ev;
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+            ev.data.u64 = (uint64_t)id;
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, op.fd, &ev) < 0) {
+                conns.release(id);
+                bare(op.probe);
+                closeProbe(op.fd, op.source);
+                continue;
+            }
+            Conn &c = conns[id];
+            c.fd = op.fd;
+            c.source = op.source;
+            c.probe = op.probe;
+            c.rtt = &rtt_->forHost(op.probe.host, targets_.address(op.probe.host));
+            c.step = 0;
+            c.deadline_ms = now + (uint64_t)banner_timeout_ms_;
+            nextProbe(id);
+        }
+        if (conns.empty()) continue;
+
+        int wait_ms = wheel.nextTimeoutMs(TimingWheel::nowMs());
+        if (!conns.full() && (wait_ms < 0 || wait_ms > BANNER_POLL_MS)) wait_ms = BANNER_POLL_MS;
+
+        int n = epoll_wait(epfd, events.data(), (int)events.size(), wait_ms);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(epfd);
+            epfd = -1;
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int id = (int)events[i].data.u64;
+            if (conns.live(id)) readable(id);
+        }
+
+        // the current step's wait ran out: on to the next one
+        expired.clear();
+        wheel.advance(TimingWheel::nowMs(), expired);
+        for (int id : expired) {
+            if (!conns.live(id)) continue;
+            ++conns[id].step;
+            nextProbe(id);
+        }
+    }
+
+    if (epfd >= 0) {
+        close(epfd);
+    } else {
+        // no reactor: the ports are open all the same
+        conns.forEach([&](int, Conn& c) {
+            bare(c.probe);
+            closeProbe(c.fd, c.source);
+        });
+        std::unique_lock<std::mutex> lk(queue_mutex_);
+        while (true) {
+            queue_cv_.wait(lk, [&]() { return !banner_queue_.empty() || stop_workers_; });
+            if (banner_queue_.empty()) break;
+            OpenPort op = banner_queue_.front();
+            banner_queue_.pop_front();
+            bare(op.probe);
+            closeProbe(op.fd, op.source);
+        }
+    }
+    mergeResults(local);
+}
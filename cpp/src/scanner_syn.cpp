@@ -0,0 +1,485 @@
+#include "scanner.h"
+#include "packet.h"
+#include "siphash.h"
+#include "sniffer.h"
+#include <atomic>
+
+using namespace std;
+
+namespace {
+
+const int SEND_BATCH = 64;
+
+// longest the sender sleeps without draining the result sink
+const uint64_t DRAIN_NS = 5000000;
+
+// A SYN to an on-link host that does not answer ARP sits in the neighbour
+// queue, charged to the socket, until resolution fails seconds later. A full
+// send buffer is waited on this many times (200us each) before the rest of
+// the batch is dropped; dropped probes are retried or expire like lost ones.
+const int SEND_STALLS = 25;
+const int SEND_BUFFER = 4 << 20;
+
+int icmpUnreachError(uint8_t code) {
+    switch (code) {
+    case 0:  return ENETUNREACH;
+    case 1:  return EHOSTUNREACH;
+    case 3:  return ECONNREFUSED;
+    default: return EACCES;      // administratively prohibited & co.
+    }
+}
+
+// ICMPv6 destination unreachable codes (RFC 4443)
+int icmp6UnreachError(uint8_t code) {
+    switch (code) {
+    case 0:  return ENETUNREACH;
+    case 3:  return EHOSTUNREACH;
+    case 4:  return ECONNREFUSED;
+    default: return EACCES;      // administratively prohibited & co.
+    }
+}
+
+// source address the kernel would use to reach `dst`
+bool sourceAddressFor(const IpAddr& dst, IpAddr& src) {
+    int fd = socket(dst.family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    struct sockaddr_storage probe, self;
+    socklen_t len = dst.toSockaddr(9, probe);
+    bool ok = connect(fd, (struct sockaddr*)&probe, len) == 0;
+    len = sizeof(self);
+    ok = ok && getsockname(fd, (struct sockaddr*)&self, &len) == 0 &&
+         IpAddr::fromSockaddr((struct sockaddr*)&self, src);
+    close(fd);
+    return ok;
+}
+
+// Claim a TCP source port on `src` so the kernel does not hand it out to
+// other connections while raw probes use it: `port` itself, or any free
+// one when it is 0. Returns the holder fd.
+int reserveSourcePort(const IpAddr& src, uint16_t& port) {
+    int fd = socket(src.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_storage a;
+    socklen_t len = src.toSockaddr(port, a);
+    if (bind(fd, (struct sockaddr*)&a, len) < 0 ||
+        getsockname(fd, (struct sockaddr*)&a, &len) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    port = ntohs(a.ss_family == AF_INET6 ? ((struct sockaddr_in6*)&a)->sin6_port
+                                         : ((struct sockaddr_in*)&a)->sin_port);
+    return fd;
+}
+
+// What the sweep sends from, per address family of the targets.
+struct Sender {
+    bool used = false;
+    IpAddr src;
+    int holder = -1;   // reserveSourcePort()
+    int tx = -1;       // raw socket
+
+    void close() {
+        if (holder >= 0) ::close(holder);
+        if (tx >= 0) ::close(tx);
+        holder = tx = -1;
+    }
+};
+
+} // namespace
+
+// =================== runSyn ===================
+// Half-open scan: SYNs are stamped out of a precomputed template and pushed
+// through an IPPROTO_RAW socket in sendmmsg() batches, so no kernel socket
+// is created per probe. A receiver thread drains the Sniffer's TPACKET_V3
+// ring and classifies SYN-ACK (open), RST (closed) and ICMP unreachable
+// replies; a port is recorded the moment its reply comes in. Probes are
+// stateless: each sequence number is a SipHash cookie of
+// the probe's 4-tuple plus the attempt number, so a reply is validated (and
+// tells which attempt it answers) by hashing the tuple it arrived on, with
+// no per-probe table. A port still silent one timeout after its SYN is
+// probed again (up to max_retries_ times, backing off), interleaved with
+// the fresh ports; ports that never answer within timeout_ms_ of the last
+// probe are reported as ETIMEDOUT right then, so the resolved part of the
+// sweep (streaming, checkpoints) keeps moving.
+//
+// The sweep walks the (host, port) indexes in the same order_ as the
+// connect workers, one template serving every host: fillTo() patches in the
+// destination. Whether a port still waits for its answer is its state in
+// results_, so nothing else is kept per (host, port). Source address and
+// capture interface are those of the route to the first host of each
+// family; IPv6 hosts get their probes from a Syn6Template through an
+// AF_INET6 raw socket, sharing the source port, cookie and sniffer ring.
+//
+// With --rate, each sendmmsg() batch is cut down to the slots the Pacer
+// grants, and the sender sleeps on an absolute CLOCK_MONOTONIC deadline
+// until the next slot opens.
+//
+// The sender runs on run()'s thread, so it also drains the result sink
+// between batches: streamed results go out while the sweep is on.
+//
+// Needs CAP_NET_RAW. The kernel answers the SYN-ACKs with RST on its own,
+// since no local socket owns the connection.
+void Scanner::runSyn() {
+    // senders[0] for IPv4 targets, senders[1] for IPv6 ones
+    Sender senders[2];
+    auto closeAll = [&]() {
+        for (auto &sd : senders) sd.close();
+    };
+    const int families[2] = {AF_INET, AF_INET6};
+    int ifindex = -1;
+    for (int f = 0; f < 2; ++f) {
+        uint64_t first;
+        if (!targets_.first(families[f], first)) continue;
+        Sender &sd = senders[f];
+        sd.used = true;
+        if (!sourceAddressFor(targets_.address(first), sd.src)) {
+            last_error_ = errno ? errno : EHOSTUNREACH;
+            return;
+        }
+        // one capture interface, or all when the families route apart
+        int idx = Sniffer::interfaceFor(sd.src);
+        ifindex = (ifindex < 0 || ifindex == idx) ? idx : 0;
+    }
+
+    // the same source port on both families, so one filter sees all replies
+    uint16_t sport = 0;
+    for (int tries = 0; tries < 16; ++tries) {
+        sport = 0;
+        bool ok = true;
+        for (auto &sd : senders) {
+            if (sd.used && (sd.holder = reserveSourcePort(sd.src, sport)) < 0) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok) break;
+        int err = errno;
+        closeAll();
+        if (err != EADDRINUSE) {
+            last_error_ = err;
+            return;
+        }
+        sport = 0;
+    }
+    if (sport == 0) {
+        last_error_ = EADDRINUSE;
+        return;
+    }
+
+    // the ring must be live before the first probe leaves
+    Sniffer sniffer;
+    int rc = sniffer.openLive(ifindex, sport);
+    if (rc < 0) {
+        last_error_ = -rc;
+        closeAll();
+        return;
+    }
+
+    for (int f = 0; f < 2; ++f) {
+        Sender &sd = senders[f];
+        if (!sd.used) continue;
+        sd.tx = socket(families[f], SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_RAW);
+        if (sd.tx < 0) {
+            last_error_ = errno;
+            closeAll();
+            return;
+        }
+        // SO_SNDBUF is silently capped at net.core.wmem_max; with
+        // CAP_NET_ADMIN the cap is lifted
+        int sndbuf = SEND_BUFFER;
+        if (setsockopt(sd.tx, SOL_SOCKET, SO_SNDBUFFORCE, &sndbuf, sizeof(sndbuf)) < 0) {
+            setsockopt(sd.tx, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        }
+    }
+
+    const uint64_t total = results_.size();
+    const int nports = end_port_ - start_port_ + 1;
+    // a resumed sweep skips what the checkpoint says is done, and nothing
+    // is sent to the family slots a hostname had no address for
+    uint64_t expected = total - resume_pos_ - resumed_ahead_;
+    for (uint64_t host = 0; host < targets_.size(); ++host) {
+        if (targets_.state(host) != TargetSet::HostState::Absent) continue;
+        for (uint64_t idx = host * nports; idx < (host + 1) * nports; ++idx) {
+            if (order_.position(idx) >= resume_pos_) --expected;
+        }
+    }
+
+    const ProbeCookie cookie;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> receiver_done{false};
+    std::atomic<uint64_t> answered{0};   // replies and expired ports
+    std::vector<ScanResult> rx_local;
+
+    // ports whose last probe went unanswered, and probes the kernel refused
+    // to send (no route, firewall), handed from the sender to the receiver,
+    // which records them
+    struct Failed {
+        uint64_t index;
+        int attempt;
+        int error;
+    };
+    std::mutex expired_mutex;
+    std::vector<uint64_t> expired, expiring;
+    std::vector<Failed> failed, failing;
+
+    // Only the receiver thread records ports while the sweep is on, so a
+    // port whose state is already set has been answered (or expired) before.
+    auto onReply = [&](const ProbeReply& r) {
+        const Sender &sd = senders[r.addr.v6()];
+        if (!sd.used) return;
+        int attempt = cookie.attempt(r.ack, sd.src, r.addr, r.local_port, r.port, max_retries_);
+        if (attempt < 0) return;
+        uint64_t host;
+        if (r.port < start_port_ || r.port > end_port_ || !targets_.find(r.addr, host)) return;
+        if (results_.state(host, r.port) != PortState::Unscanned) return;
+
+        int verdict;
+        switch (r.kind) {
+        case ProbeReply::SYN_ACK:      verdict = 0; break;
+        case ProbeReply::RST:          verdict = ECONNREFUSED; break;
+        case ProbeReply::ICMP_UNREACH:
+            verdict = r.addr.v6() ? icmp6UnreachError(r.icmp_code) : icmpUnreachError(r.icmp_code);
+            break;
+        default: return;
+        }
+        answered.fetch_add(1);
+
+        ScanResult res;
+        res.host = host;
+        res.port = r.port;
+        res.open = (verdict == 0);
+        res.error_code = verdict;
+        res.probes = attempt + 1;
+        record(rx_local, std::move(res));
+    };
+
+    auto onExpired = [&]() {
+        {
+            std::lock_guard<std::mutex> lk(expired_mutex);
+            expiring.swap(expired);
+            failing.swap(failed);
+        }
+        for (const Failed &x : failing) {
+            if (results_.stateAt(x.index) != PortState::Unscanned) continue;
+            answered.fetch_add(1);
+            ScanResult r;
+            r.host = x.index / nports;
+            r.port = start_port_ + (int)(x.index % nports);
+            r.error_code = x.error;
+            r.probes = x.attempt + 1;
+            record(rx_local, std::move(r));
+        }
+        failing.clear();
+        for (uint64_t idx : expiring) {
+            if (results_.stateAt(idx) != PortState::Unscanned) continue;
+            answered.fetch_add(1);
+            ScanResult r;
+            r.host = idx / nports;
+            r.port = start_port_ + (int)(idx % nports);
+            r.error_code = ETIMEDOUT;
+            r.probes = max_retries_ + 1;
+            record(rx_local, std::move(r));
+        }
+        expiring.clear();
+    };
+
+    std::thread receiver([&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (sniffer.poll(20, onReply) < 0) break;
+            onExpired();
+        }
+        receiver_done.store(true, std::memory_order_release);
+    });
+
+    SynTemplate tmpl;
+    tmpl.init(senders[0].src.v4(), 0, sport);
+    Syn6Template tmpl6;
+    tmpl6.init(senders[1].src.bytes, sport);
+    TargetSet::Cursor hosts(targets_);
+
+    // a batch is split by family into one sendmmsg() per raw socket
+    std::vector<uint8_t> pkts(SEND_BATCH * Syn6Template::LEN);
+    struct iovec iov[SEND_BATCH];
+    struct mmsghdr msgs[2][SEND_BATCH];
+    struct sockaddr_storage dsts[SEND_BATCH];
+
+    Pacer pacer;
+    initPacer(pacer, 0, 1);
+    uint64_t probes = 0, last_probe_ns = 0;
+
+    // unanswered SYNs are resent from one FIFO per attempt: every entry of
+    // a level waits the same delay, so each FIFO stays ordered by due time.
+    // The last level holds final probes waiting out timeout_ms_ before
+    // their port expires.
+    struct Resend {
+        uint64_t due_ns;
+        uint64_t index;
+    };
+    std::vector<std::deque<Resend>> resend(max_retries_ + 1);
+    auto &final_wait = resend[max_retries_];
+    struct Out {
+        uint64_t index;
+        int attempt;
+    };
+    Out batch[SEND_BATCH];
+    uint64_t next_fresh = resume_pos_;
+
+    auto sleepUntil = [](uint64_t at_ns) {
+        struct timespec at;
+        at.tv_sec = (time_t)(at_ns / 1000000000ull);
+        at.tv_nsec = (long)(at_ns % 1000000000ull);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, nullptr);
+    };
+    // earliest due retry, 0 when none is queued
+    auto firstDue = [&]() {
+        uint64_t due = 0;
+        for (auto &q : resend) {
+            if (!q.empty() && (due == 0 || q.front().due_ns < due)) due = q.front().due_ns;
+        }
+        return due;
+    };
+
+    while (answered.load() < expected) {
+        drainSink();
+        uint64_t now_ns = Pacer::nowNs();
+        if (!final_wait.empty() && final_wait.front().due_ns <= now_ns) {
+            std::lock_guard<std::mutex> lk(expired_mutex);
+            for (; !final_wait.empty() && final_wait.front().due_ns <= now_ns; final_wait.pop_front()) {
+                expired.push_back(final_wait.front().index);
+            }
+        }
+        uint64_t due = firstDue();
+        if (next_fresh >= total) {
+            if (due == 0) break;
+            if (due > now_ns) {
+                sleepUntil(std::min(due, now_ns + DRAIN_NS));
+                continue;
+            }
+        }
+
+        uint64_t next_ns = 0;
+        unsigned granted;
+        while ((granted = pacer.take(SEND_BATCH, now_ns, next_ns)) == 0) {
+            sleepUntil(std::min(next_ns, now_ns + DRAIN_NS));
+            drainSink();
+            now_ns = Pacer::nowNs();
+        }
+
+        // due retries first (skipping ports that answered meanwhile), then
+        // fresh ports, so retries ride along with the sweep
+        int cnt = 0;
+        for (int level = 0; level < max_retries_; ++level) {
+            auto &q = resend[level];
+            while (cnt < (int)granted && !q.empty() && q.front().due_ns <= now_ns) {
+                uint64_t idx = q.front().index;
+                q.pop_front();
+                if (results_.stateAt(idx) == PortState::Unscanned) batch[cnt++] = Out{idx, level + 1};
+            }
+        }
+        while (cnt < (int)granted && next_fresh < total) {
+            uint64_t idx = order_(next_fresh++);
+            if (results_.stateAt(idx) == PortState::Unscanned && !absent(idx)) batch[cnt++] = Out{idx, 0};
+        }
+        pacer.refund(granted - (unsigned)cnt);
+
+        int nmsgs[2] = {0, 0};
+        int slot[2][SEND_BATCH];   // msgs[f][j] carries batch[slot[f][j]]
+        int send_err[SEND_BATCH] = {};
+        for (int i = 0; i < cnt; ++i) {
+            uint8_t* p = pkts.data() + i * Syn6Template::LEN;
+            const IpAddr daddr = hosts.address(batch[i].index / nports);
+            const int f = daddr.v6();
+            uint16_t dport = (uint16_t)(start_port_ + (int)(batch[i].index % nports));
+            uint32_t seq = cookie.make(senders[f].src, daddr, sport, dport) + (uint32_t)batch[i].attempt;
+            if (f) {
+                tmpl6.fillTo(p, daddr.bytes, dport, seq);
+                iov[i].iov_len = Syn6Template::LEN;
+            } else {
+                tmpl.fillTo(p, daddr.v4(), dport, seq);
+                iov[i].iov_len = SynTemplate::LEN;
+            }
+            iov[i].iov_base = p;
+            slot[f][nmsgs[f]] = i;
+            struct mmsghdr &m = msgs[f][nmsgs[f]++];
+            memset(&m, 0, sizeof(m));
+            m.msg_hdr.msg_name = &dsts[i];
+            m.msg_hdr.msg_namelen = daddr.toSockaddr(0, dsts[i]);
+            m.msg_hdr.msg_iov = &iov[i];
+            m.msg_hdr.msg_iovlen = 1;
+        }
+
+        // a probe the kernel rejects is reported with that error; one left
+        // over after the stalls is scheduled below like a lost one
+        for (int f = 0; f < 2; ++f) {
+            int done = 0, stalls = 0;
+            while (done < nmsgs[f]) {
+                int n = sendmmsg(senders[f].tx, msgs[f] + done, nmsgs[f] - done, 0);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == ENOBUFS || errno == EAGAIN) {
+                        // queues full: give them a moment to drain, then give up
+                        if (++stalls > SEND_STALLS) break;
+                        std::this_thread::sleep_for(std::chrono::microseconds(200));
+                        continue;
+                    }
+                    // the first unsent message failed (e.g. no route), go on
+                    send_err[slot[f][done++]] = errno;
+                    continue;
+                }
+                done += n;
+                probes += n;
+            }
+        }
+        last_probe_ns = now_ns;
+
+        bool any_failed = false;
+        for (int i = 0; i < cnt; ++i) {
+            if (send_err[i] != 0) {
+                any_failed = true;
+                continue;
+            }
+            int a = batch[i].attempt + 1;
+            if (a > max_retries_) {
+                final_wait.push_back(Resend{now_ns + (uint64_t)timeout_ms_ * 1000000ull, batch[i].index});
+                continue;
+            }
+            resend[a - 1].push_back(Resend{now_ns + (uint64_t)retryDelayMs(a, nullptr) * 1000000ull, batch[i].index});
+        }
+        if (any_failed) {
+            std::lock_guard<std::mutex> lk(expired_mutex);
+            for (int i = 0; i < cnt; ++i) {
+                if (send_err[i] != 0) failed.push_back(Failed{batch[i].index, batch[i].attempt, send_err[i]});
+            }
+        }
+    }
+    countProbes(probes, last_probe_ns);
+
+    // the final waits above were the grace period for late replies. The
+    // receiver may still be blocked in record() on a full sink, which only
+    // this thread drains, so keep draining until it is out.
+    stop = true;
+    while (!receiver_done.load(std::memory_order_acquire)) {
+        if (drainSink() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    receiver.join();
+    onExpired();
+
+    closeAll();
+
+    // whatever is left never answered either
+    std::vector<ScanResult> local;
+    for (uint64_t pos = resume_pos_; pos < total; ++pos) {
+        uint64_t idx = order_(pos);
+        if (results_.stateAt(idx) != PortState::Unscanned || absent(idx)) continue;
+        ScanResult r;
+        r.host = idx / nports;
+        r.port = start_port_ + (int)(idx % nports);
+        r.error_code = ETIMEDOUT;
+        r.probes = max_retries_ + 1;
+        record(local, r);
+    }
+    mergeResults(local);
+    mergeResults(rx_local);
+}
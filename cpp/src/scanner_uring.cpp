@@ -0,0 +1,299 @@
+#include "scanner.h"
+#include "uring.h"
+
+using namespace std;
+
+// =================== uringAvailable ===================
+bool Scanner::uringAvailable() {
+    IoUring ring;
+    return ring.init(4) == 0;
+}
+
+#ifdef PENREC_HAVE_IO_URING
+
+namespace {
+
+// user_data = slot << 3 | op
+enum UringOp : uint64_t {
+    OP_CONNECT    = 1,
+    OP_HANDOFF    = 4,   // retry timer for a full banner queue, slot unused
+    OP_TIMEOUT    = 5,   // linked timeout completions, ignored
+    OP_CLOSE      = 6,   // close completions, ignored
+    OP_PACE       = 7,   // --rate timer, slot unused
+};
+
+inline uint64_t tag(int slot, UringOp op) { return ((uint64_t)slot << 3) | op; }
+
+struct UringConn {
+    int fd = -1;
+    int source = -1;   // Scanner::sources_ entry
+    uint64_t host = 0;
+    int port = 0;
+    int attempt = 0;
+    uint64_t started_us = 0;
+    RttEstimator* rtt = nullptr;       // the host's, from Scanner::rtt_
+    struct __kernel_timespec ts {};  // connect timeout, read at submit time
+    struct sockaddr_storage addr {};
+    socklen_t addrlen = 0;
+};
+
+} // namespace
+
+// =================== uringWorkerLoop ===================
+// io_uring flavour of workerLoop(). Per port it costs one socket() call; the
+// connect with its timeout and the close of a closed/filtered port are
+// queued as SQEs and go to the kernel in one io_uring_enter per loop
+// iteration:
+//
+//   CONNECT -> LINK_TIMEOUT
+//   CLOSE                          unless the port is open
+//
+// Open sockets are switched to non-blocking and handed to the banner stage,
+// like in workerLoop(); a full queue keeps the slot busy and is retried on a
+// BANNER_POLL_MS timer.
+//
+// Timeouts are enforced by the kernel, so no timing wheel is needed here.
+// The connect timeout is taken per port from the probed host's RTT
+// estimator. A timed-out connect is handed back to the feed as a retry, like
+// in workerLoop(). With --rate, a paced refill parks on an absolute
+// IORING_OP_TIMEOUT until the Pacer's next slot.
+bool Scanner::uringWorkerLoop(int shard, int nshards) {
+    int window = std::max(1, in_flight_limit_ / nshards);
+
+    // worst case per slot: connect + link timeout queued, close of the
+    // previous socket pending; plus the pacer and handoff timeouts
+    unsigned entries = 8;
+    while (entries < (unsigned)window * 3 + 2 && entries < 32768) entries <<= 1;
+    window = std::min(window, (int)((entries - 2) / 3));
+
+    IoUring ring;
+    if (ring.init(entries) < 0) return false;
+
+    std::vector<ScanResult> local;
+    PortFeed feed(order_, results_, targets_, resume_pos_ + (uint64_t)shard, nshards, start_port_,
+                  end_port_ - start_port_ + 1);
+    TargetSet::Cursor hosts(targets_);
+
+    // connection state by slot; the slot id travels in user_data
+    Slab<UringConn> conns(window);
+
+    Pacer pacer;
+    initPacer(pacer, shard, nshards);
+    struct __kernel_timespec pace_ts {};
+    bool pace_armed = false;
+    uint64_t probes = 0, last_probe_ns = 0;
+
+    // make room for a chain of `n` SQEs so a link is never split by a flush
+    auto reserve = [&](unsigned n) {
+        if (ring.sqSpace() < n) ring.submit(0);
+    };
+
+    // free `slot`; its socket is closed unless the banner stage took it
+    auto release = [&](int slot, bool close_fd = true) {
+        UringConn &c = conns[slot];
+        if (close_fd) {
+            reserve(1);
+            IoUring::prepClose(ring.getSqe(), c.fd, tag(slot, OP_CLOSE));
+            sources_.release(c.source);
+        }
+        c.fd = -1;
+        conns.release(slot);
+    };
+
+    // slots whose open socket waits for room in the banner queue
+    std::vector<int> handoff;
+    struct __kernel_timespec handoff_ts {};
+    bool handoff_armed = false;
+    auto handOff = [&](int slot) {
+        UringConn &c = conns[slot];
+        if (offerBanner(OpenPort{c.fd, Probe{c.host, c.port, c.attempt}, c.source})) {
+            release(slot, false);
+            return true;
+        }
+        return false;
+    };
+
+    auto report = [&](uint64_t host, int port, bool open, int err, int probes = 1) {
+        ScanResult r;
+        r.host = host;
+        r.port = port;
+        r.probes = probes;
+        r.open = open;
+        r.error_code = err;
+        record(local, r);
+    };
+
+    auto setTimeout = [](struct __kernel_timespec& ts, int ms) {
+        ts.tv_sec = ms / 1000;
+        ts.tv_nsec = (long long)(ms % 1000) * 1000000;
+    };
+
+    auto refill = [&]() {
+        Probe probe;
+        while (!conns.full()) {
+            uint64_t now_ns = Pacer::nowNs(), next_ns = 0;
+            if (pacer.take(1, now_ns, next_ns) == 0) {
+                if (!pace_armed) {
+                    pace_ts.tv_sec = (long long)(next_ns / 1000000000ull);
+                    pace_ts.tv_nsec = (long long)(next_ns % 1000000000ull);
+                    reserve(1);
+                    IoUring::prepTimeout(ring.getSqe(), &pace_ts, IORING_TIMEOUT_ABS, tag(0, OP_PACE));
+                    pace_armed = true;
+                }
+                break;
+            }
+            if (feed.take(probe, TimingWheel::nowMs()) != PortFeed::READY) {
+                pacer.refund(1);
+                break;
+            }
+            const int port = probe.port;
+
+            // blocking socket on purpose: io_uring drives it asynchronously
+            const IpAddr dst = hosts.address(probe.host);
+            int source;
+            int fd = probeSocket(dst.family, 0, source);
+            if (fd < 0) {
+                int err = errno;
+                pacer.refund(1);
+                if (isResourceError(err) && feed.defer(probe, conns.empty(), TimingWheel::nowMs())) break;
+                report(probe.host, port, false, err);
+                continue;
+            }
+
+            int slot = conns.alloc();
+            feed.started();
+
+            UringConn &c = conns[slot];
+            c.fd = fd;
+            c.source = source;
+            c.host = probe.host;
+            c.port = port;
+            c.attempt = probe.attempt;
+            c.addrlen = dst.toSockaddr((uint16_t)port, c.addr);
+            c.rtt = &rtt_->forHost(probe.host, dst);
+            setTimeout(c.ts, c.rtt->timeoutMs());
+            c.started_us = RttEstimator::nowUs();
+            ++probes;
+            last_probe_ns = now_ns;
+
+            reserve(2);
+            struct io_uring_sqe* sqe = ring.getSqe();
+            IoUring::prepConnect(sqe, fd, (struct sockaddr*)&c.addr, c.addrlen, tag(slot, OP_CONNECT));
+            sqe->flags |= IOSQE_IO_LINK;
+            IoUring::prepLinkTimeout(ring.getSqe(), &c.ts, tag(slot, OP_TIMEOUT));
+        }
+    };
+
+    int ring_err = 0;
+    refill();
+    while (!conns.empty() || feed.hasDeferred() || pace_armed) {
+        // retry open sockets the banner queue had no room for
+        size_t kept = 0;
+        for (int slot : handoff) {
+            if (!handOff(slot)) handoff[kept++] = slot;
+        }
+        handoff.resize(kept);
+        if (!handoff.empty() && !handoff_armed) {
+            setTimeout(handoff_ts, BANNER_POLL_MS);
+            reserve(1);
+            IoUring::prepTimeout(ring.getSqe(), &handoff_ts, 0, tag(0, OP_HANDOFF));
+            handoff_armed = true;
+        }
+
+        if (conns.empty() && !pace_armed) {
+            // only deferred ports left: sit out their backoff
+            int wait_ms = feed.waitMs(TimingWheel::nowMs());
+            if (wait_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+            refill();
+            continue;
+        }
+
+        int rc = ring.submit(1);
+        if (rc < 0 && rc != -EBUSY && rc != -EAGAIN) {
+            ring_err = -rc;
+            break;
+        }
+
+        struct io_uring_cqe* cqe;
+        while ((cqe = ring.peekCqe()) != nullptr) {
+            uint64_t ud = cqe->user_data;
+            int res = cqe->res;
+            ring.cqeSeen();
+
+            UringOp op = (UringOp)(ud & 7);
+            int slot = (int)(ud >> 3);
+            if (op == OP_PACE) {
+                pace_armed = false;
+                continue;
+            }
+            if (op == OP_HANDOFF) {
+                handoff_armed = false;
+                continue;
+            }
+            if (op == OP_TIMEOUT || op == OP_CLOSE) continue;
+            UringConn &c = conns[slot];
+
+            switch (op) {
+            case OP_CONNECT:
+                if (res == 0 || res == -ECONNREFUSED) {
+                    c.rtt->sample(RttEstimator::nowUs() - c.started_us);
+                }
+                if (res == 0) {
+                    int flags = fcntl(c.fd, F_GETFL, 0);
+                    fcntl(c.fd, F_SETFL, flags | O_NONBLOCK);
+                    if (!handOff(slot)) handoff.push_back(slot);
+                } else {
+                    int err = (res == -ECANCELED) ? ETIMEDOUT : -res;
+                    Probe probe{c.host, c.port, c.attempt};
+                    const RttEstimator* rtt = c.rtt;
+                    release(slot);
+                    if (isResourceError(err) && feed.defer(probe, conns.empty(), TimingWheel::nowMs())) break;
+                    if (err == ETIMEDOUT && probe.attempt < max_retries_) {
+                        ++probe.attempt;
+                        feed.retry(probe, TimingWheel::nowMs() + retryDelayMs(probe.attempt, rtt));
+                        break;
+                    }
+                    report(probe.host, probe.port, false, err, probe.attempt + 1);
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        refill();
+    }
+
+    // ring failed hard: report what is still pending
+    for (int slot : handoff) {
+        UringConn &c = conns[slot];
+        report(c.host, c.port, true, 0, c.attempt + 1);
+        closeProbe(c.fd, c.source);
+        c.fd = -1;
+    }
+    conns.forEach([&](int, UringConn& c) {
+        if (c.fd < 0) return;
+        report(c.host, c.port, false, ring_err);
+        closeProbe(c.fd, c.source);
+    });
+    for (const Probe& probe : feed.requeue) report(probe.host, probe.port, false, ring_err);
+    for (; !feed.retries.empty(); feed.retries.pop()) {
+        const Probe& probe = feed.retries.top().probe;
+        report(probe.host, probe.port, false, ring_err);
+    }
+
+    // flush the remaining CLOSE SQEs; the ring teardown waits for them
+    ring.submit(0);
+    countProbes(probes, last_probe_ns);
+    mergeResults(local);
+    return true;
+}
+
+#else
+
+bool Scanner::uringWorkerLoop(int, int) {
+    return false;
+}
+
+#endif // PENREC_HAVE_IO_URING
@@ -0,0 +1,105 @@
+#include "siphash.h"
+#include <cstring>
+#include <random>
+#include <sys/random.h>
+
+// =================== siphash24 ===================
+static inline uint64_t rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static inline uint64_t load64le(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+#define SIPROUND                                                   \
+    do {                                                           \
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);  \
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;                     \
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;                     \
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);  \
+    } while (0)
+
+uint64_t siphash24(const uint8_t key[16], const void* data, size_t len) {
+    const uint8_t* in = (const uint8_t*)data;
+    uint64_t k0 = load64le(key);
+    uint64_t k1 = load64le(key + 8);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const uint8_t* end = in + (len - len % 8);
+    for (; in != end; in += 8) {
+        uint64_t m = load64le(in);
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    uint64_t b = (uint64_t)len << 56;
+    switch (len & 7) {
+    case 7: b |= (uint64_t)in[6] << 48; /* fall through */
+    case 6: b |= (uint64_t)in[5] << 40; /* fall through */
+    case 5: b |= (uint64_t)in[4] << 32; /* fall through */
+    case 4: b |= (uint64_t)in[3] << 24; /* fall through */
+    case 3: b |= (uint64_t)in[2] << 16; /* fall through */
+    case 2: b |= (uint64_t)in[1] << 8;  /* fall through */
+    case 1: b |= (uint64_t)in[0];       break;
+    case 0: break;
+    }
+
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef SIPROUND
+
+// =================== ProbeCookie ===================
+ProbeCookie::ProbeCookie() {
+    if (getrandom(key_, sizeof(key_), 0) != (ssize_t)sizeof(key_)) {
+        std::random_device rd;
+        for (size_t i = 0; i < sizeof(key_); i += 4) {
+            uint32_t r = rd();
+            memcpy(key_ + i, &r, 4);
+        }
+    }
+}
+
+ProbeCookie::ProbeCookie(const uint8_t key[16]) {
+    memcpy(key_, key, sizeof(key_));
+}
+
+uint32_t ProbeCookie::make(uint32_t saddr, uint32_t daddr, uint16_t sport, uint16_t dport) const {
+    uint8_t tuple[12];
+    memcpy(tuple, &saddr, 4);
+    memcpy(tuple + 4, &daddr, 4);
+    tuple[8] = (uint8_t)(sport >> 8);
+    tuple[9] = (uint8_t)sport;
+    tuple[10] = (uint8_t)(dport >> 8);
+    tuple[11] = (uint8_t)dport;
+    return (uint32_t)siphash24(key_, tuple, sizeof(tuple));
+}
+
+uint32_t ProbeCookie::make(const IpAddr& saddr, const IpAddr& daddr, uint16_t sport, uint16_t dport) const {
+    if (!daddr.v6()) return make(saddr.v4(), daddr.v4(), sport, dport);
+    uint8_t tuple[36];
+    memcpy(tuple, saddr.bytes, 16);
+    memcpy(tuple + 16, daddr.bytes, 16);
+    tuple[32] = (uint8_t)(sport >> 8);
+    tuple[33] = (uint8_t)sport;
+    tuple[34] = (uint8_t)(dport >> 8);
+    tuple[35] = (uint8_t)dport;
+    return (uint32_t)siphash24(key_, tuple, sizeof(tuple));
+}
@@ -0,0 +1,51 @@
+#ifndef SIPHASH_H
+#define SIPHASH_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ip_addr.h"
+
+// SipHash-2-4 (Aumasson & Bernstein) with a 128-bit key.
+uint64_t siphash24(const uint8_t key[16], const void* data, size_t len);
+
+// Stateless probe validation for raw scans: the sequence number of every
+// probe is a keyed hash of its 4-tuple, so a reply is genuine iff its ack
+// (or the sequence number quoted in an ICMP error) matches the hash of the
+// tuple it came back on. Nothing is stored per probe.
+class ProbeCookie {
+public:
+    // fresh random key
+    ProbeCookie();
+    explicit ProbeCookie(const uint8_t key[16]);
+
+    // addresses in network byte order, ports in host byte order
+    uint32_t make(uint32_t saddr, uint32_t daddr, uint16_t sport, uint16_t dport) const;
+
+    // either family; both addresses must be of the same one
+    uint32_t make(const IpAddr& saddr, const IpAddr& daddr, uint16_t sport, uint16_t dport) const;
+
+    // `ack` is the acknowledgement of a reply from daddr:dport to saddr:sport
+    bool valid(uint32_t ack, uint32_t saddr, uint32_t daddr, uint16_t sport, uint16_t dport) const {
+        return ack == make(saddr, daddr, sport, dport) + 1;
+    }
+
+    // Retries of a probe use make() + attempt as sequence number, so a reply
+    // also tells which attempt it answers: that number, or -1 if `ack`
+    // matches none of attempts 0..max_attempt.
+    int attempt(uint32_t ack, uint32_t saddr, uint32_t daddr, uint16_t sport, uint16_t dport,
+                int max_attempt) const {
+        uint32_t d = ack - 1 - make(saddr, daddr, sport, dport);
+        return d <= (uint32_t)max_attempt ? (int)d : -1;
+    }
+
+    int attempt(uint32_t ack, const IpAddr& saddr, const IpAddr& daddr, uint16_t sport, uint16_t dport,
+                int max_attempt) const {
+        uint32_t d = ack - 1 - make(saddr, daddr, sport, dport);
+        return d <= (uint32_t)max_attempt ? (int)d : -1;
+    }
+
+private:
+    uint8_t key_[16];
+};
+
+#endif // SIPHASH_H
@@ -0,0 +1,62 @@
+#ifndef SLAB_H
+#define SLAB_H
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Fixed-capacity pool of T addressed by small integer ids. All slots are
+// allocated up front, so alloc()/release() never touch the heap. Ids are
+// dense (0 .. capacity-1), which makes them usable as epoll_event.data,
+// io_uring user_data or TimingWheel ids directly.
+//
+// Freed ids are reused last-in first-out, so a busy reactor keeps cycling
+// through the same few cache-warm slots.
+template <typename T>
+class Slab {
+public:
+    explicit Slab(int capacity) : items_(capacity), live_(capacity, 0) {
+        free_.reserve(capacity);
+        for (int i = capacity - 1; i >= 0; --i) free_.push_back(i);
+    }
+
+    // id of a free slot (its T keeps whatever the last user left there),
+    // or -1 when the slab is full
+    int alloc() {
+        if (free_.empty()) return -1;
+        int id = free_.back();
+        free_.pop_back();
+        live_[id] = 1;
+        return id;
+    }
+
+    void release(int id) {
+        live_[id] = 0;
+        free_.push_back(id);
+    }
+
+    T& operator[](int id) { return items_[id]; }
+    const T& operator[](int id) const { return items_[id]; }
+
+    // true if `id` is in range and currently allocated
+    bool live(int id) const { return id >= 0 && id < capacity() && live_[id]; }
+
+    int capacity() const { return (int)items_.size(); }
+    int size() const { return capacity() - (int)free_.size(); }
+    bool empty() const { return size() == 0; }
+    bool full() const { return free_.empty(); }
+
+    // call f(id, item) for every allocated slot
+    template <typename F>
+    void forEach(F f) {
+        for (int id = 0; id < capacity(); ++id) {
+            if (live_[id]) f(id, items_[id]);
+        }
+    }
+
+private:
+    std::vector<T> items_;
+    std::vector<uint8_t> live_;
+    std::vector<int> free_;
+};
+
+#endif // SLAB_H
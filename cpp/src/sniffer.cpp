@@ -0,0 +1,376 @@
+#include "sniffer.h"
+#include "packet.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <ifaddrs.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// classic pcap file format: a file header, then a record header before
+// every packet, all in the byte order of the machine that wrote it
+const uint32_t PCAP_MAGIC      = 0xa1b2c3d4;   // microsecond timestamps
+const uint32_t PCAP_MAGIC_NSEC = 0xa1b23c4d;   // nanosecond timestamps
+const size_t PCAP_FILE_HEADER = 24;
+const size_t PCAP_RECORD_HEADER = 16;
+const uint32_t PCAP_MAX_RECORD = 1 << 18;
+
+// link types as stored in pcap files
+enum : uint32_t {
+    LINKTYPE_NULL       = 0,
+    LINKTYPE_ETHERNET   = 1,
+    LINKTYPE_RAW        = 101,
+    LINKTYPE_LINUX_SLL  = 113,
+    LINKTYPE_IPV4       = 228,
+    LINKTYPE_IPV6       = 229,
+    LINKTYPE_LINUX_SLL2 = 276,
+};
+
+uint32_t fileWord(const uint8_t* p, bool swapped) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+} // namespace
+
+// =================== lifetime ===================
+Sniffer::~Sniffer() {
+    close();
+}
+
+void Sniffer::close() {
+    if (ring_) munmap(ring_, ring_len_);
+    ring_ = nullptr;
+    ring_len_ = 0;
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    if (pcap_) fclose(pcap_);
+    pcap_ = nullptr;
+}
+
+int Sniffer::interfaceFor(const IpAddr& addr) {
+    struct ifaddrs* ifs = nullptr;
+    if (getifaddrs(&ifs) < 0) return 0;
+    int idx = 0;
+    for (struct ifaddrs* it = ifs; it; it = it->ifa_next) {
+        IpAddr a;
+        if (!it->ifa_addr || !IpAddr::fromSockaddr(it->ifa_addr, a)) continue;
+        if (a == addr) {
+            idx = (int)if_nametoindex(it->ifa_name);
+            break;
+        }
+    }
+    freeifaddrs(ifs);
+    return idx;
+}
+
+// =================== openLive ===================
+int Sniffer::openLive(int ifindex, uint16_t local_port, unsigned block_size, unsigned block_nr) {
+    close();
+    local_port_ = local_port;
+    stats_ = Stats();
+
+    // SOCK_DGRAM: frames start at the IP header whatever the link type
+    fd_ = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, htons(ETH_P_ALL));
+    if (fd_ < 0) return -errno;
+
+    // filter before the ring is mapped so no foreign traffic lands in it
+    int rc = attachFilter();
+    if (rc < 0) { close(); return rc; }
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        rc = -errno; close(); return rc;
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = block_size;
+    req.tp_block_nr = block_nr;
+    req.tp_frame_size = 2048;
+    req.tp_frame_nr = (block_size / req.tp_frame_size) * block_nr;
+    req.tp_retire_blk_tov = 10;   // ms: hand partially filled blocks over quickly
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        rc = -errno; close(); return rc;
+    }
+
+    ring_len_ = (size_t)block_size * block_nr;
+    void* ring = mmap(nullptr, ring_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd_, 0);
+    if (ring == MAP_FAILED) {
+        // MAP_LOCKED needs RLIMIT_MEMLOCK headroom; the ring works without it
+        ring = mmap(nullptr, ring_len_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    }
+    if (ring == MAP_FAILED) { rc = -errno; ring_len_ = 0; close(); return rc; }
+    ring_ = (uint8_t*)ring;
+    block_size_ = block_size;
+    block_nr_ = block_nr;
+    block_idx_ = 0;
+
+    struct sockaddr_ll ll;
+    memset(&ll, 0, sizeof(ll));
+    ll.sll_family = AF_PACKET;
+    ll.sll_protocol = htons(ETH_P_ALL);
+    ll.sll_ifindex = ifindex;
+    if (bind(fd_, (struct sockaddr*)&ll, sizeof(ll)) < 0) {
+        rc = -errno; close(); return rc;
+    }
+    return 0;
+}
+
+// Classic BPF over the IP header: keep unfragmented TCP to local_port_ and
+// all ICMP, or for IPv6 TCP to local_port_ and ICMPv6 destination
+// unreachable; drop the rest (ARP & co. included) in the kernel.
+int Sniffer::attachFilter() {
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, (uint32_t)(SKF_AD_OFF + SKF_AD_PROTOCOL)), // 0: ethertype
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 8),          // 1: not IPv4 -> 10
+        BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 9),                      // 2: protocol
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_TCP, 0, 5),       // 3: not TCP -> 9
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 6),                      // 4: flags + fragment offset
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 13, 0),          // 5: fragment -> drop
+        BPF_STMT(BPF_LDX | BPF_B   | BPF_MSH, 0),                      // 6: X = IP header length
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, 2),                      // 7: TCP destination port
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, local_port_, 9, 10),      // 8: ours -> accept
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_ICMP, 8, 9),      // 9: ICMP -> accept
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IPV6, 0, 8),        // 10: not IPv6 -> drop
+        BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 6),                      // 11: next header
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_TCP, 0, 2),       // 12: not TCP -> 15
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 42),                     // 13: TCP destination port
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, local_port_, 3, 4),       // 14: ours -> accept
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_ICMPV6, 0, 3),    // 15: not ICMPv6 -> drop
+        BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 40),                     // 16: ICMPv6 type
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 1, 0, 1),                 // 17: unreachable -> accept
+        BPF_STMT(BPF_RET | BPF_K, 0x40000),                             // 18: accept
+        BPF_STMT(BPF_RET | BPF_K, 0),                                   // 19: drop
+    };
+
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) return -errno;
+    return 0;
+}
+
+// =================== openOffline ===================
+int Sniffer::openOffline(const std::string& path, uint16_t local_port) {
+    close();
+    local_port_ = local_port;
+    stats_ = Stats();
+    FILE* f = fopen(path.c_str(), "rbe");
+    if (!f) return -errno;
+
+    uint8_t hdr[PCAP_FILE_HEADER];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) {
+        fclose(f);
+        return -EINVAL;
+    }
+    uint32_t magic = fileWord(hdr, false);
+    swapped_ = magic == __builtin_bswap32(PCAP_MAGIC) || magic == __builtin_bswap32(PCAP_MAGIC_NSEC);
+    if (!swapped_ && magic != PCAP_MAGIC && magic != PCAP_MAGIC_NSEC) {
+        fclose(f);
+        return -EINVAL;   // not a pcap file (pcapng included)
+    }
+    pcap_ = f;
+    linktype_ = (int)(fileWord(hdr + 20, swapped_) & 0xffff);
+    return 0;
+}
+
+// =================== poll ===================
+int Sniffer::poll(int timeout_ms, const Handler& handler) {
+    if (pcap_) return pollOffline(handler);
+    if (!ring_) return -EBADF;
+
+    int delivered = 0;
+    bool waited = false;
+    for (;;) {
+        struct tpacket_block_desc* bd =
+            (struct tpacket_block_desc*)(ring_ + (size_t)block_idx_ * block_size_);
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            if (delivered > 0 || waited) return delivered;
+            struct pollfd pfd = {fd_, POLLIN | POLLERR, 0};
+            int rc = ::poll(&pfd, 1, timeout_ms);
+            if (rc < 0) return errno == EINTR ? 0 : -errno;
+            if (rc == 0) return 0;
+            waited = true;
+            continue;
+        }
+
+        delivered += walkBlock(bd, handler);
+        __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        block_idx_ = (block_idx_ + 1) % block_nr_;
+    }
+}
+
+int Sniffer::walkBlock(void* block, const Handler& handler) {
+    struct tpacket_block_desc* bd = (struct tpacket_block_desc*)block;
+    uint32_t n = bd->hdr.bh1.num_pkts;
+    uint8_t* p = (uint8_t*)block + bd->hdr.bh1.offset_to_first_pkt;
+    int delivered = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        struct tpacket3_hdr* h = (struct tpacket3_hdr*)p;
+        struct sockaddr_ll* ll = (struct sockaddr_ll*)(p + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+        ++stats_.packets;
+        // our own probes show up as outgoing copies on the same interface
+        if (ll->sll_pkttype != PACKET_OUTGOING) {
+            if (handlePacket(p + h->tp_net, h->tp_snaplen, handler)) ++delivered;
+        }
+        p += h->tp_next_offset;
+    }
+    return delivered;
+}
+
+int Sniffer::pollOffline(const Handler& handler) {
+    int delivered = 0;
+    uint8_t rec[PCAP_RECORD_HEADER];
+    std::vector<uint8_t> buf;
+    for (;;) {
+        size_t got = fread(rec, 1, sizeof(rec), pcap_);
+        if (got == 0 && feof(pcap_)) return delivered;
+        if (got != sizeof(rec)) return -EIO;
+        uint32_t caplen = fileWord(rec + 8, swapped_);
+        if (caplen > PCAP_MAX_RECORD) return -EIO;
+        buf.resize(caplen);
+        if (fread(buf.data(), 1, caplen, pcap_) != caplen) return -EIO;
+        ++stats_.packets;
+
+        const uint8_t* data = buf.data();
+        size_t off;
+        switch ((uint32_t)linktype_) {
+        case LINKTYPE_ETHERNET: {
+            off = 14;
+            // skip 802.1Q tags
+            while (caplen >= off && data[off - 2] == 0x81 && data[off - 1] == 0x00) off += 4;
+            if (caplen < off) continue;
+            uint16_t type = (uint16_t)((data[off - 2] << 8) | data[off - 1]);
+            if (type != ETH_P_IP && type != ETH_P_IPV6) continue;
+            break;
+        }
+        case LINKTYPE_NULL:       off = 4;  break;
+        case LINKTYPE_LINUX_SLL:  off = 16; break;
+        case LINKTYPE_LINUX_SLL2: off = 20; break;
+        case LINKTYPE_RAW:
+        case LINKTYPE_IPV4:
+        case LINKTYPE_IPV6:
+            off = 0;
+            break;
+        default:
+            return -EPROTONOSUPPORT;
+        }
+        if (caplen <= off) continue;
+        if (handlePacket(data + off, caplen - off, handler)) ++delivered;
+    }
+}
+
+// =================== handlePacket ===================
+bool Sniffer::handlePacket(const uint8_t* ip, size_t len, const Handler& handler) {
+    if (len < 20) return false;
+    ProbeReply reply;
+
+    if ((ip[0] >> 4) == 6) {
+        if (!handleIpv6(ip, len, reply)) return false;
+    } else if ((ip[0] >> 4) != 4) {
+        return false;
+    } else if (ip[9] == IPPROTO_TCP) {
+        TcpReply t;
+        if (!parseIpv4Tcp(ip, len, t)) return false;
+        if (t.dport != local_port_ || !(t.flags & TCP_FLAG_ACK)) return false;
+        if ((t.flags & (TCP_FLAG_SYN | TCP_FLAG_RST)) == TCP_FLAG_SYN) reply.kind = ProbeReply::SYN_ACK;
+        else if (t.flags & TCP_FLAG_RST) reply.kind = ProbeReply::RST;
+        else return false;
+        reply.addr = t.saddr;
+        reply.port = t.sport;
+        reply.local_port = t.dport;
+        reply.ack = t.ack;
+    } else if (ip[9] == IPPROTO_ICMP) {
+        // destination unreachable quoting one of our SYNs: outer IP, 8 byte
+        // ICMP header, inner IP header, first 8 bytes of the TCP header
+        size_t ihl = (size_t)(ip[0] & 0x0f) * 4;
+        if (len < ihl + 8 + 20) return false;
+        const uint8_t* icmp = ip + ihl;
+        if (icmp[0] != 3) return false;
+        const uint8_t* inner = icmp + 8;
+        size_t inner_ihl = (size_t)(inner[0] & 0x0f) * 4;
+        if (inner[9] != IPPROTO_TCP || len < ihl + 8 + inner_ihl + 8) return false;
+        const uint8_t* tcp = inner + inner_ihl;
+        uint16_t sport = (uint16_t)((tcp[0] << 8) | tcp[1]);
+        if (sport != local_port_) return false;
+        uint32_t seq = ((uint32_t)tcp[4] << 24) | ((uint32_t)tcp[5] << 16) | ((uint32_t)tcp[6] << 8) | tcp[7];
+
+        reply.kind = ProbeReply::ICMP_UNREACH;
+        uint32_t addr;
+        memcpy(&addr, inner + 16, 4);
+        reply.addr = IpAddr::fromV4(addr);
+        reply.port = (uint16_t)((tcp[2] << 8) | tcp[3]);
+        reply.local_port = sport;
+        reply.ack = seq + 1;
+        reply.icmp_code = icmp[1];
+    } else {
+        return false;
+    }
+
+    ++stats_.replies;
+    handler(reply);
+    return true;
+}
+
+// TCP or ICMPv6 destination unreachable, extension headers not followed
+bool Sniffer::handleIpv6(const uint8_t* ip, size_t len, ProbeReply& reply) {
+    if (len < 40) return false;
+    if (ip[6] == IPPROTO_TCP) {
+        TcpReply t;
+        if (!parseIpv6Tcp(ip, len, t)) return false;
+        if (t.dport != local_port_ || !(t.flags & TCP_FLAG_ACK)) return false;
+        if ((t.flags & (TCP_FLAG_SYN | TCP_FLAG_RST)) == TCP_FLAG_SYN) reply.kind = ProbeReply::SYN_ACK;
+        else if (t.flags & TCP_FLAG_RST) reply.kind = ProbeReply::RST;
+        else return false;
+        reply.addr = t.saddr;
+        reply.port = t.sport;
+        reply.local_port = t.dport;
+        reply.ack = t.ack;
+        return true;
+    }
+    if (ip[6] != IPPROTO_ICMPV6) return false;
+
+    // outer IPv6, 8 byte ICMPv6 header, the quoted IPv6 header and at
+    // least the first 8 bytes of our SYN
+    if (len < 40 + 8 + 40 + 8) return false;
+    const uint8_t* icmp = ip + 40;
+    if (icmp[0] != 1) return false;
+    const uint8_t* inner = icmp + 8;
+    if (inner[6] != IPPROTO_TCP) return false;
+    const uint8_t* tcp = inner + 40;
+    uint16_t sport = (uint16_t)((tcp[0] << 8) | tcp[1]);
+    if (sport != local_port_) return false;
+    uint32_t seq = ((uint32_t)tcp[4] << 24) | ((uint32_t)tcp[5] << 16) | ((uint32_t)tcp[6] << 8) | tcp[7];
+
+    reply.kind = ProbeReply::ICMP_UNREACH;
+    reply.addr = IpAddr::fromV6(inner + 24);
+    reply.port = (uint16_t)((tcp[2] << 8) | tcp[3]);
+    reply.local_port = sport;
+    reply.ack = seq + 1;
+    reply.icmp_code = icmp[1];
+    return true;
+}
+
+// =================== stats ===================
+Sniffer::Stats Sniffer::stats() {
+    if (fd_ >= 0) {
+        // the kernel counters reset on every read
+        struct tpacket_stats_v3 st;
+        socklen_t len = sizeof(st);
+        if (getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) {
+            stats_.drops += st.tp_drops;
+        }
+    }
+    return stats_;
+}
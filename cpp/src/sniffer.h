@@ -0,0 +1,101 @@
+#ifndef SNIFFER_H
+#define SNIFFER_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include "ip_addr.h"
+#include <string>
+
+// A scan reply seen on the wire, reduced to what the scan engine needs.
+// For ICMP errors the fields describe the quoted probe, so a reply can be
+// matched the same way whether it came back as TCP or ICMP.
+struct ProbeReply {
+    enum Kind : uint8_t {
+        SYN_ACK,        // port open
+        RST,            // port closed
+        ICMP_UNREACH,   // probe rejected on the path, see icmp_code
+    };
+
+    Kind kind = RST;
+    IpAddr addr;              // probed host; an IPv6 host means ICMPv6 codes
+    uint16_t port = 0;        // probed port
+    uint16_t local_port = 0;  // our source port
+    uint32_t ack = 0;         // TCP ack, or quoted sequence number + 1 for ICMP
+    uint8_t icmp_code = 0;
+};
+
+// High-rate receive path for raw scan modes. Live capture uses an AF_PACKET
+// TPACKET_V3 ring: the kernel fills whole blocks of packets and the sniffer
+// walks them in place, so the only syscall is a poll() when no block is
+// ready. A classic BPF filter attached to the socket keeps everything but
+// TCP segments to our source port, ICMP and ICMPv6 destination unreachable
+// out of the ring. IPv4 and IPv6 share the ring.
+//
+// Offline mode replays a classic pcap file (as tcpdump -w writes it, not
+// pcapng) through the same parser, which is how the reply handling is
+// exercised without privileges or a live target (cpp/test/test_sniffer.cpp).
+class Sniffer {
+public:
+    using Handler = std::function<void(const ProbeReply&)>;
+
+    struct Stats {
+        uint64_t packets = 0;   // seen by the ring (live) or read (offline)
+        uint64_t drops = 0;     // ring overruns reported by the kernel
+        uint64_t replies = 0;   // delivered to the handler
+    };
+
+    Sniffer() = default;
+    ~Sniffer();
+    Sniffer(const Sniffer&) = delete;
+    Sniffer& operator=(const Sniffer&) = delete;
+
+    // capture IPv4 and IPv6 on interface `ifindex` (0: all interfaces) into a ring
+    // of block_nr blocks of block_size bytes; only replies addressed to
+    // local_port are kept. Returns 0 or -errno.
+    int openLive(int ifindex, uint16_t local_port,
+                 unsigned block_size = 1 << 20, unsigned block_nr = 32);
+
+    // read packets from a pcap file instead; returns 0 or -errno (-EINVAL
+    // for a file that is not classic pcap)
+    int openOffline(const std::string& path, uint16_t local_port);
+
+    // deliver every reply that is ready, waiting up to timeout_ms for the
+    // first block (live) ; returns replies delivered, 0 on timeout or end of
+    // file, -errno on error
+    int poll(int timeout_ms, const Handler& handler);
+
+    void close();
+
+    Stats stats();
+
+    // interface index that owns the address `addr`, 0 if none does
+    static int interfaceFor(const IpAddr& addr);
+
+private:
+    int fd_ = -1;
+    uint16_t local_port_ = 0;
+
+    uint8_t* ring_ = nullptr;
+    size_t ring_len_ = 0;
+    unsigned block_size_ = 0;
+    unsigned block_nr_ = 0;
+    unsigned block_idx_ = 0;
+
+    FILE* pcap_ = nullptr;       // offline mode
+    bool swapped_ = false;       // file written in the other byte order
+    int linktype_ = 0;
+
+    Stats stats_;
+
+    int attachFilter();
+    int walkBlock(void* block, const Handler& handler);
+    int pollOffline(const Handler& handler);
+
+    // parse an IP packet and hand a matching reply to the handler
+    bool handlePacket(const uint8_t* ip, size_t len, const Handler& handler);
+    bool handleIpv6(const uint8_t* ip, size_t len, ProbeReply& reply);
+};
+
+#endif // SNIFFER_H
@@ -0,0 +1,114 @@
+#include "source_pool.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+namespace {
+
+// size of the kernel's ephemeral port range (the default one if unreadable)
+int ephemeralPorts() {
+    std::ifstream in("/proc/sys/net/ipv4/ip_local_port_range");
+    int lo = 0, hi = 0;
+    if (in >> lo >> hi && hi >= lo && lo > 0) return hi - lo + 1;
+    return 60999 - 32768 + 1;
+}
+
+// bind `fd` to `addr` and leave the port to connect()
+int bindNoPort(int fd, const IpAddr& addr) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+    struct sockaddr_storage ss;
+    socklen_t len = addr.toSockaddr(0, ss);
+    return bind(fd, (struct sockaddr*)&ss, len);
+}
+
+} // namespace
+
+// =================== SourcePool ===================
+SourcePool::SourcePool() {
+    sources_.emplace_back();
+    sources_.emplace_back();
+    sources_[1].addr.family = AF_INET6;
+    budget_ = ephemeralPorts() / 8 * 7;
+}
+
+int SourcePool::add(const std::string& specs) {
+    size_t pos = 0;
+    while (pos <= specs.size()) {
+        size_t comma = specs.find(',', pos);
+        if (comma == std::string::npos) comma = specs.size();
+        std::string spec = specs.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (spec.empty()) continue;
+
+        uint8_t buf[16];
+        IpAddr addr;
+        if (inet_pton(AF_INET, spec.c_str(), buf) == 1) {
+            uint32_t v4;
+            memcpy(&v4, buf, 4);
+            addr = IpAddr::fromV4(v4);
+        } else if (inet_pton(AF_INET6, spec.c_str(), buf) == 1) {
+            addr = IpAddr::fromV6(buf);
+        } else {
+            return EINVAL;
+        }
+        sources_.emplace_back();
+        sources_.back().addr = addr;
+        sources_.back().bind = true;
+        family_[addr.v6()].push_back((int)sources_.size() - 1);
+    }
+    return 0;
+}
+
+int SourcePool::prepare() {
+    budget_ = ephemeralPorts() / 8 * 7;
+    next_ = 0;
+    for (Source& s : sources_) {
+        s.used = 0;
+        if (!s.bind) continue;
+        int fd = socket(s.addr.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return errno;
+        int rc = bindNoPort(fd, s.addr);
+        int err = errno;
+        close(fd);
+        if (rc < 0) return err;
+    }
+    return 0;
+}
+
+int SourcePool::acquire(int fd, int family) {
+    const int f = family == AF_INET6;
+    const std::vector<int>& own = family_[f];
+    const int n = own.empty() ? 1 : (int)own.size();
+
+    // round robin, skipping sources that are at their budget
+    const uint32_t start = next_.fetch_add(1, std::memory_order_relaxed);
+    for (int k = 0; k < n; ++k) {
+        int id = own.empty() ? f : own[(start + (uint32_t)k) % (uint32_t)n];
+        Source& s = sources_[id];
+        if (s.used.fetch_add(1, std::memory_order_relaxed) >= budget_) {
+            s.used.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (s.bind && bindNoPort(fd, s.addr) < 0) {
+            int err = errno;
+            s.used.fetch_sub(1, std::memory_order_relaxed);
+            errno = err;
+            return -1;
+        }
+        return id;
+    }
+    errno = EADDRNOTAVAIL;
+    return -1;
+}
+
+void SourcePool::release(int source) {
+    if (source >= 0) sources_[source].used.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,59 @@
+#ifndef SOURCE_POOL_H
+#define SOURCE_POOL_H
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "ip_addr.h"
+
+// Local addresses connect probes go out from, each with its own budget of
+// ephemeral ports. A probe socket is bound to a source with
+// IP_BIND_ADDRESS_NO_PORT, so the kernel still picks the port at connect()
+// time (and may share it between different destinations) instead of
+// reserving one per bind().
+//
+// Every source counts the probe sockets that hold one of its ports, from
+// acquire() until release(). Once a source reaches its budget (7/8 of
+// ip_local_port_range), acquire() fails with EADDRNOTAVAIL and the caller
+// backs off, rather than running the kernel out of ports and having
+// connect() fail. A family without configured addresses uses one implicit
+// source that binds nothing and only counts.
+//
+// Configure before run(); acquire() and release() are thread-safe.
+class SourcePool {
+public:
+    SourcePool();
+
+    // add one address or a comma-separated list; 0 or EINVAL
+    int add(const std::string& specs);
+    bool empty() const { return sources_.size() == 2; }
+
+    // check that every address can be bound here (EADDRNOTAVAIL if not) and
+    // reset the counts; 0 or errno
+    int prepare();
+
+    // bind `fd` (a socket of `family`) to a source with ports left; returns
+    // the source to release() later, or -1 with errno set
+    int acquire(int fd, int family);
+    void release(int source);
+
+    // ports one source may hold at once
+    int budget() const { return budget_; }
+
+private:
+    struct Source {
+        IpAddr addr;
+        bool bind = false;          // false: the implicit source of a family
+        std::atomic<int> used{0};
+    };
+
+    // 0 and 1 are the implicit IPv4 and IPv6 sources, configured ones follow
+    std::deque<Source> sources_;
+    std::vector<int> family_[2];    // configured sources per family
+    int budget_ = 0;
+    std::atomic<uint32_t> next_{0};
+};
+
+#endif // SOURCE_POOL_H
@@ -0,0 +1,348 @@
+#include "targets.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+namespace {
+
+using u128 = unsigned __int128;
+
+// IPv4 or IPv6 text to a host-order number
+bool parseAddr(const std::string& s, uint8_t& family, u128& out) {
+    uint8_t b[16];
+    if (s.find(':') == std::string::npos) {
+        if (inet_pton(AF_INET, s.c_str(), b) != 1) return false;
+        family = AF_INET;
+        out = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+        return true;
+    }
+    if (inet_pton(AF_INET6, s.c_str(), b) != 1) return false;
+    family = AF_INET6;
+    out = 0;
+    for (int i = 0; i < 16; ++i) out = (out << 8) | b[i];
+    return true;
+}
+
+bool parseNumber(const std::string& s, long lo, long hi, long& out) {
+    if (s.empty() || s.size() > 10) return false;
+    char* end = nullptr;
+    out = strtol(s.c_str(), &end, 10);
+    return *end == '\0' && out >= lo && out <= hi;
+}
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return std::string();
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+inline u128 firstOf(uint64_t hi, uint64_t lo) {
+    return ((u128)hi << 64) | lo;
+}
+
+u128 valueOf(const IpAddr& a) {
+    if (!a.v6()) return ntohl(a.v4());
+    u128 v = 0;
+    for (int b = 0; b < 16; ++b) v = (v << 8) | a.bytes[b];
+    return v;
+}
+
+// IPv6 blocks and ranges are capped like an IPv4 /0: a host number must
+// still fit next to its ports in 64 bits
+const u128 MAX_RANGE = (u128)1 << 32;
+
+} // namespace
+
+// =================== add ===================
+int TargetSet::add(const std::string& specs) {
+    size_t pos = 0;
+    while (pos <= specs.size()) {
+        size_t comma = specs.find(',', pos);
+        if (comma == std::string::npos) comma = specs.size();
+        std::string spec = trim(specs.substr(pos, comma - pos));
+        if (!spec.empty()) {
+            int err = addOne(spec);
+            if (err) return err;
+        }
+        pos = comma + 1;
+    }
+    return 0;
+}
+
+int TargetSet::addOne(const std::string& spec) {
+    uint8_t family, last_family;
+    u128 first, last;
+
+    size_t slash = spec.find('/');
+    if (slash != std::string::npos) {
+        long bits;
+        if (!parseAddr(spec.substr(0, slash), family, first)) return EINVAL;
+        int width = family == AF_INET6 ? 128 : 32;
+        if (!parseNumber(spec.substr(slash + 1), width == 128 ? 96 : 0, width, bits)) return EINVAL;
+        u128 count = (u128)1 << (width - bits);
+        first &= ~(count - 1);
+        addRange(family, first, (uint64_t)count);
+        return 0;
+    }
+
+    // a dash after an address is a range; otherwise it belongs to a name
+    size_t dash = spec.find('-');
+    if (dash != std::string::npos && parseAddr(spec.substr(0, dash), family, first)) {
+        std::string tail = spec.substr(dash + 1);
+        long octet;
+        if (family == AF_INET && parseNumber(tail, 0, 255, octet)) {
+            last = (first & 0xffffff00u) | (uint32_t)octet;
+        } else if (!parseAddr(tail, last_family, last) || last_family != family) {
+            return EINVAL;
+        }
+        if (last < first || last - first >= MAX_RANGE) return EINVAL;
+        addRange(family, first, (uint64_t)(last - first) + 1);
+        return 0;
+    }
+
+    if (parseAddr(spec, family, first)) {
+        addRange(family, first, 1);
+        return 0;
+    }
+
+    // anything else must be a hostname, resolved later (a bad address
+    // such as 10.0.0.300 is not one)
+    bool numeric = true;
+    for (char c : spec) {
+        if (!isalnum((unsigned char)c) && c != '-' && c != '.' && c != '_') return EINVAL;
+        numeric = numeric && (isdigit((unsigned char)c) || c == '.');
+    }
+    if (numeric) return EINVAL;
+    addName(spec);
+    return 0;
+}
+
+void TargetSet::addName(const std::string& name) {
+    name_base_.push_back(total_);
+    ranges_.push_back(Range{AF_UNSPEC, 0, (uint64_t)name_text_.size(), 2, total_});
+    total_ += 2;
+    name_text_.push_back(name);
+    name_hosts_.emplace_back();
+    name_hosts_.emplace_back();
+}
+
+// =================== addFile ===================
+int TargetSet::addFile(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return errno ? errno : ENOENT;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        for (char& c : line) {
+            if (c == ' ' || c == '\t') c = ',';
+        }
+        int err = add(line);
+        if (err) return err;
+    }
+    return 0;
+}
+
+void TargetSet::addRange(uint8_t family, u128 first, uint64_t count) {
+    Range r{family, (uint64_t)(first >> 64), (uint64_t)first, count, total_};
+    ranges_.push_back(r);
+    total_ += count;
+    spans_stale_.store(true, std::memory_order_release);
+}
+
+void TargetSet::clear() {
+    ranges_.clear();
+    total_ = 0;
+    {
+        std::lock_guard<std::mutex> lk(spans_mutex_);
+        spans_.clear();
+        spans_stale_ = false;
+    }
+    name_text_.clear();
+    name_hosts_.clear();
+    name_base_.clear();
+    std::lock_guard<std::mutex> lk(names_mutex_);
+    by_name_addr_.clear();
+}
+
+// =================== buildSpans ===================
+// Sweep over the range boundaries in address order, keeping the ranges
+// that cover the current stretch; each stretch belongs to the lowest range
+// index among them (the first added, so its hosts are numbered lowest).
+// Stretches with the same owner that touch are merged into one span.
+void TargetSet::buildSpans() const {
+    std::lock_guard<std::mutex> lk(spans_mutex_);
+    if (!spans_stale_.load(std::memory_order_relaxed)) return;
+
+    struct Edge {
+        uint8_t family;
+        u128 at;
+        size_t range;
+        bool open;
+    };
+    std::vector<Edge> edges;
+    for (size_t k = 0; k < ranges_.size(); ++k) {
+        const Range& r = ranges_[k];
+        if (r.family == AF_UNSPEC) continue;
+        u128 first = firstOf(r.hi, r.lo);
+        edges.push_back(Edge{r.family, first, k, true});
+        edges.push_back(Edge{r.family, first + r.count, k, false});
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) {
+        if (x.family != y.family) return x.family < y.family;
+        return x.at < y.at;
+    });
+
+    spans_.clear();
+    std::set<size_t> active;
+    for (size_t e = 0; e < edges.size();) {
+        const uint8_t family = edges[e].family;
+        const u128 at = edges[e].at;
+        for (; e < edges.size() && edges[e].family == family && edges[e].at == at; ++e) {
+            if (edges[e].open) active.insert(edges[e].range);
+            else active.erase(edges[e].range);
+        }
+        // the stretch up to the next edge, which always exists while
+        // any range is open (its closing edge comes later)
+        if (active.empty()) continue;
+        const size_t owner = *active.begin();
+        const u128 last = edges[e].at - 1;
+        if (!spans_.empty() && spans_.back().range == owner && spans_.back().family == family &&
+            spans_.back().last + 1 == at) {
+            spans_.back().last = last;
+        } else {
+            spans_.push_back(Span{family, at, last, owner});
+        }
+    }
+    spans_stale_.store(false, std::memory_order_release);
+}
+
+// =================== address ===================
+size_t TargetSet::rangeOf(uint64_t i) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), i,
+                               [](uint64_t v, const Range& r) { return v < r.base; });
+    return (size_t)(it - ranges_.begin()) - 1;
+}
+
+IpAddr TargetSet::at(const Range& r, uint64_t offset) const {
+    if (r.family == AF_INET) return IpAddr::fromV4(htonl((uint32_t)(r.lo + offset)));
+    if (r.family == AF_UNSPEC) return name_hosts_[2 * r.lo + offset].addr;
+    u128 v = firstOf(r.hi, r.lo) + offset;
+    IpAddr a;
+    a.family = AF_INET6;
+    for (int b = 15; b >= 0; --b, v >>= 8) a.bytes[b] = (uint8_t)v;
+    return a;
+}
+
+IpAddr TargetSet::address(uint64_t i) const {
+    const Range& r = ranges_[rangeOf(i)];
+    return at(r, i - r.base);
+}
+
+IpAddr TargetSet::Cursor::address(uint64_t i) {
+    const auto& ranges = set_->ranges_;
+    const Range* r = &ranges[range_];
+    if (i < r->base || i >= r->base + r->count) {
+        range_ = set_->rangeOf(i);
+        r = &ranges[range_];
+    }
+    return set_->at(*r, i - r->base);
+}
+
+// =================== names ===================
+TargetSet::HostState TargetSet::state(uint64_t i) const {
+    int64_t slot = nameSlot(i);
+    if (slot < 0) return HostState::Ready;
+    return (HostState)name_hosts_[(size_t)slot].state.load(std::memory_order_acquire);
+}
+
+uint64_t TargetSet::nameHost(size_t n, int family) const {
+    return name_base_[n] + (family == AF_INET6 ? 1 : 0);
+}
+
+int64_t TargetSet::nameSlot(uint64_t i) const {
+    if (name_text_.empty()) return -1;
+    const Range& r = ranges_[rangeOf(i)];
+    if (r.family != AF_UNSPEC) return -1;
+    return (int64_t)(2 * r.lo + (i - r.base));
+}
+
+void TargetSet::resolve(uint64_t i, const IpAddr* addr) {
+    int64_t slot = nameSlot(i);
+    if (slot < 0) return;
+    NameHost& h = name_hosts_[(size_t)slot];
+    if (!addr) {
+        h.state.store((uint8_t)HostState::Absent, std::memory_order_release);
+        return;
+    }
+    h.addr = *addr;
+    {
+        std::lock_guard<std::mutex> lk(names_mutex_);
+        by_name_addr_.emplace(*addr, i);
+    }
+    h.state.store((uint8_t)HostState::Ready, std::memory_order_release);
+}
+
+// =================== find ===================
+// Ranges may overlap; any range holding the address will do, the one
+// added first is preferred.
+bool TargetSet::find(const IpAddr& addr, uint64_t& i) const {
+    if (spans_stale_.load(std::memory_order_acquire)) buildSpans();
+    u128 a = valueOf(addr);
+    auto it = std::upper_bound(spans_.begin(), spans_.end(), a, [&](u128 v, const Span& s) {
+        if (addr.family != s.family) return addr.family < s.family;
+        return v < s.first;
+    });
+    if (it != spans_.begin() && (--it)->family == addr.family && a <= it->last) {
+        const Range& r = ranges_[it->range];
+        i = r.base + (uint64_t)(a - firstOf(r.hi, r.lo));
+        return true;
+    }
+    if (name_text_.empty()) return false;
+    std::lock_guard<std::mutex> lk(names_mutex_);
+    auto named = by_name_addr_.find(addr);
+    if (named == by_name_addr_.end()) return false;
+    i = named->second;
+    return true;
+}
+
+bool TargetSet::first(int family, uint64_t& i) const {
+    for (const Range& r : ranges_) {
+        uint64_t host = r.base + (r.family == AF_UNSPEC && family == AF_INET6 ? 1 : 0);
+        if (r.family == family || (r.family == AF_UNSPEC && state(host) == HostState::Ready)) {
+            i = host;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t TargetSet::fingerprint() const {
+    uint64_t h = 0xcbf29ce484222325ull;   // FNV-1a
+    auto mix = [&h](uint64_t v) {
+        for (int i = 0; i < 8; ++i, v >>= 8) {
+            h ^= v & 0xff;
+            h *= 0x100000001b3ull;
+        }
+    };
+    for (const Range& r : ranges_) {
+        if (r.family == AF_UNSPEC) {
+            for (char c : name_text_[r.lo]) mix((uint8_t)c);
+            mix(r.count);
+            continue;
+        }
+        if (r.family == AF_INET6) {
+            mix(AF_INET6);
+            mix(r.hi);
+        }
+        mix(r.lo);
+        mix(r.count);
+    }
+    return h;
+}
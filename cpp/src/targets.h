@@ -0,0 +1,138 @@
+#ifndef TARGETS_H
+#define TARGETS_H
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include "ip_addr.h"
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The hosts of a scan, kept as address ranges and never expanded: a /8 is
+// one entry. Hosts are numbered 0 .. size()-1 in the order they were added;
+// address(i) maps a number back to its address, and a Cursor does the same
+// in O(1) for the mostly-sequential access of a sweep.
+//
+// Accepted specs, also as comma-separated lists:
+//   10.0.0.7               single address
+//   10.0.0.0/24            CIDR block (network and broadcast included)
+//   10.0.0.10-10.0.1.20    inclusive range
+//   10.0.0.10-20           range within the last octet
+//   fd00::7                IPv6 address
+//   fd00::/120             IPv6 prefix of /96 or longer (at most 2^32 hosts)
+//   fd00::10-fd00::20      inclusive IPv6 range of at most 2^32 hosts
+//   scanme.example.org     hostname: its first IPv4 and its first IPv6
+//                          address, if it has them
+// A set may mix both families.
+//
+// A hostname is not resolved when it is added. It takes two host numbers,
+// one per family, whose addresses are filled in by resolve() as answers
+// come in, possibly while a scan already runs: until then such a host is
+// Pending, and a family the name turns out not to have stays Absent.
+class TargetSet {
+public:
+    // add one spec or a comma-separated list; 0 or EINVAL (malformed or
+    // too large)
+    int add(const std::string& specs);
+
+    // add every spec in a file: one or more per line, separated by
+    // whitespace or commas; '#' starts a comment. 0 or errno.
+    int addFile(const std::string& path);
+
+    void clear();
+
+    uint64_t size() const { return total_; }
+    bool empty() const { return total_ == 0; }
+
+    enum class HostState : uint8_t { Ready, Pending, Absent };
+
+    // whether host `i` has an address yet; always Ready but for hostnames
+    HostState state(uint64_t i) const;
+
+    // address of host `i` (i < size(), state Ready)
+    IpAddr address(uint64_t i) const;
+
+    // hostnames in the order they were added; name n owns the hosts
+    // nameHost(n, AF_INET) and nameHost(n, AF_INET6)
+    const std::vector<std::string>& names() const { return name_text_; }
+    uint64_t nameHost(size_t n, int family) const;
+    // 0 .. 2*names()-1 for a hostname's host, -1 for any other
+    int64_t nameSlot(uint64_t i) const;
+
+    // publish what a name's host resolved to, nullptr for nothing (Absent).
+    // Safe while other threads read the set.
+    void resolve(uint64_t i, const IpAddr* addr);
+
+    // number of the first host with address `addr`; false if none
+    bool find(const IpAddr& addr, uint64_t& i) const;
+
+    // number of the first host of `family` (AF_INET/AF_INET6) with an
+    // address; false if none
+    bool first(int family, uint64_t& i) const;
+
+    // hash of the hosts and their numbering, to tell target sets apart
+    uint64_t fingerprint() const;
+
+    // address(i) with the range of the previous lookup cached
+    class Cursor {
+    public:
+        explicit Cursor(const TargetSet& set) : set_(&set) {}
+        IpAddr address(uint64_t i);
+
+    private:
+        const TargetSet* set_;
+        size_t range_ = 0;
+    };
+
+private:
+    // first address as a 128-bit number in host order (IPv4: lo only); a
+    // hostname is a range of 2 with family AF_UNSPEC and its name in lo
+    struct Range {
+        uint8_t family;
+        uint64_t hi, lo;
+        uint64_t count;
+        uint64_t base;     // number of the range's first host
+    };
+
+    // a name's two hosts: the address is written before the state is
+    // released, and read only after the state says Ready
+    struct NameHost {
+        IpAddr addr;
+        std::atomic<uint8_t> state{(uint8_t)HostState::Pending};
+    };
+
+    // a stretch of addresses and the range whose hosts they are: the
+    // first range added where several overlap
+    struct Span {
+        uint8_t family;
+        unsigned __int128 first, last;
+        size_t range;
+    };
+
+    std::vector<Range> ranges_;
+    uint64_t total_ = 0;
+
+    // address index for find(): non-overlapping spans sorted by family and
+    // address, rebuilt by the first find() after ranges were added
+    mutable std::vector<Span> spans_;
+    mutable std::atomic<bool> spans_stale_{false};
+    mutable std::mutex spans_mutex_;
+
+    std::vector<std::string> name_text_;
+    std::deque<NameHost> name_hosts_;     // 2 per name: IPv4, IPv6
+    std::vector<uint64_t> name_base_;     // host number of each name's IPv4 host
+    mutable std::mutex names_mutex_;
+    std::map<IpAddr, uint64_t> by_name_addr_;   // resolved names' hosts
+
+    int addOne(const std::string& spec);
+    void addName(const std::string& name);
+    void addRange(uint8_t family, unsigned __int128 first, uint64_t count);
+    size_t rangeOf(uint64_t i) const;
+    void buildSpans() const;
+    IpAddr at(const Range& r, uint64_t offset) const;
+};
+
+#endif // TARGETS_H
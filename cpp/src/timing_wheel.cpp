@@ -0,0 +1,163 @@
+#include "timing_wheel.h"
+#include <chrono>
+#include <climits>
+
+// =================== Constructor ===================
+TimingWheel::TimingWheel(uint64_t now_ms) : now_(now_ms) {
+    for (int l = 0; l < LEVELS; ++l) {
+        for (int s = 0; s < SLOTS; ++s) heads_[l][s] = -1;
+        for (int w = 0; w < SLOTS / 64; ++w) bitmap_[l][w] = 0;
+    }
+}
+
+uint64_t TimingWheel::nowMs() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// =================== schedule / cancel ===================
+void TimingWheel::schedule(int id, uint64_t deadline_ms) {
+    if (id < 0) return;
+    if ((size_t)id >= nodes_.size()) nodes_.resize((size_t)id + 1);
+    if (nodes_[id].level >= 0) unlink(id);
+    nodes_[id].deadline = deadline_ms;
+    link(id);
+}
+
+void TimingWheel::cancel(int id) {
+    if (id < 0 || (size_t)id >= nodes_.size() || nodes_[id].level < 0) return;
+    unlink(id);
+}
+
+bool TimingWheel::armed(int id) const {
+    return id >= 0 && (size_t)id < nodes_.size() && nodes_[id].level >= 0;
+}
+
+// pick the level from the distance to the deadline; deadlines at or before
+// an already processed tick go to the due list, drained by the next advance()
+void TimingWheel::link(int id) {
+    Node &n = nodes_[id];
+    n.prev = -1;
+    ++count_;
+    if (n.deadline < now_) {
+        n.level = DUE;
+        n.slot = 0;
+        n.next = due_head_;
+        if (n.next >= 0) nodes_[n.next].prev = id;
+        due_head_ = id;
+        return;
+    }
+
+    uint64_t d = n.deadline;
+    uint64_t delta = d - now_;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1ULL << (SLOT_BITS * (level + 1)))) ++level;
+    if (delta >= (1ULL << (SLOT_BITS * LEVELS))) d = now_ + (1ULL << (SLOT_BITS * LEVELS)) - 1;
+
+    int slot = (int)((d >> (SLOT_BITS * level)) & SLOT_MASK);
+    n.level = (int16_t)level;
+    n.slot = (int16_t)slot;
+    n.next = heads_[level][slot];
+    if (n.next >= 0) nodes_[n.next].prev = id;
+    heads_[level][slot] = id;
+    bitmap_[level][slot >> 6] |= (1ULL << (slot & 63));
+}
+
+void TimingWheel::unlink(int id) {
+    Node &n = nodes_[id];
+    int &head = n.level == DUE ? due_head_ : heads_[n.level][n.slot];
+    if (n.prev >= 0) nodes_[n.prev].next = n.next;
+    else head = n.next;
+    if (n.next >= 0) nodes_[n.next].prev = n.prev;
+    if (n.level != DUE && head < 0) bitmap_[n.level][n.slot >> 6] &= ~(1ULL << (n.slot & 63));
+    n.level = -1;
+    n.prev = n.next = -1;
+    --count_;
+}
+
+// move every timer of the current slot at `level` down the hierarchy
+void TimingWheel::cascade(int level) {
+    int slot = (int)((now_ >> (SLOT_BITS * level)) & SLOT_MASK);
+    int id = heads_[level][slot];
+    while (id >= 0) {
+        int next = nodes_[id].next;
+        unlink(id);
+        link(id);
+        id = next;
+    }
+}
+
+// =================== advance ===================
+void TimingWheel::advance(uint64_t now_ms, std::vector<int>& expired) {
+    while (due_head_ >= 0) {
+        int id = due_head_;
+        unlink(id);
+        expired.push_back(id);
+    }
+
+    if (count_ == 0) {
+        // nothing armed: jump straight to the new time
+        if (now_ms + 1 > now_) now_ = now_ms + 1;
+        return;
+    }
+
+    while (now_ <= now_ms) {
+        // crossing a boundary of level l pulls that level's slot down
+        for (int l = 1; l < LEVELS; ++l) {
+            if ((now_ & ((1ULL << (SLOT_BITS * l)) - 1)) != 0) break;
+            cascade(l);
+        }
+
+        int slot = (int)(now_ & SLOT_MASK);
+        int id = heads_[0][slot];
+        while (id >= 0) {
+            int next = nodes_[id].next;
+            unlink(id);
+            expired.push_back(id);
+            id = next;
+        }
+        ++now_;
+
+        if (count_ == 0) {
+            if (now_ms + 1 > now_) now_ = now_ms + 1;
+            break;
+        }
+    }
+}
+
+// =================== nextTimeoutMs ===================
+int TimingWheel::findSlot(int level, int from) const {
+    for (int k = 0; k < SLOTS; ) {
+        int s = (from + k) & SLOT_MASK;
+        uint64_t word = bitmap_[level][s >> 6] >> (s & 63);
+        if (word) {
+            int off = k + __builtin_ctzll(word);
+            return off < SLOTS ? off : -1;
+        }
+        k += 64 - (s & 63);
+    }
+    return -1;
+}
+
+int TimingWheel::nextTimeoutMs(uint64_t now_ms) const {
+    if (count_ == 0) return -1;
+    if (due_head_ >= 0) return 0;
+
+    uint64_t best = UINT64_MAX;
+    for (int l = 0; l < LEVELS; ++l) {
+        uint64_t base = now_ >> (SLOT_BITS * l);
+        // once a level-l boundary has been processed, its current slot is
+        // next cascaded one full turn later
+        if ((now_ & ((1ULL << (SLOT_BITS * l)) - 1)) != 0) ++base;
+        int off = findSlot(l, (int)(base & SLOT_MASK));
+        if (off < 0) continue;
+        // tick at which that slot is expired (level 0) or cascaded (l > 0)
+        uint64_t tick = (base + off) << (SLOT_BITS * l);
+        if (tick < best) best = tick;
+    }
+
+    if (best <= now_ms) return 0;
+    uint64_t wait = best - now_ms;
+    return wait > (uint64_t)INT_MAX ? INT_MAX : (int)wait;
+}
@@ -0,0 +1,67 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel with 1 ms ticks (4 levels x 256 slots, ~49 days
+// of range). Timers are identified by small non-negative ints chosen by the
+// caller (an fd or a slot index), so schedule/cancel are O(1) and need no
+// allocation once the id space has been seen.
+class TimingWheel {
+public:
+    explicit TimingWheel(uint64_t now_ms = 0);
+
+    // (re)arm timer `id` to fire at deadline_ms; deadlines in the past fire
+    // on the next advance()
+    void schedule(int id, uint64_t deadline_ms);
+
+    // disarm timer `id`; no-op if it is not armed
+    void cancel(int id);
+
+    bool armed(int id) const;
+    bool empty() const { return count_ == 0; }
+    size_t size() const { return count_; }
+
+    // move the wheel to now_ms and append the ids of every timer whose
+    // deadline is <= now_ms to `expired` (they are disarmed)
+    void advance(uint64_t now_ms, std::vector<int>& expired);
+
+    // milliseconds from now_ms until the wheel needs to be advanced again,
+    // or -1 when no timer is armed; suitable as an epoll_wait timeout
+    int nextTimeoutMs(uint64_t now_ms) const;
+
+    // current monotonic time in ms
+    static uint64_t nowMs();
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 8;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int SLOT_MASK = SLOTS - 1;
+
+    struct Node {
+        uint64_t deadline = 0;
+        int prev = -1;
+        int next = -1;
+        int16_t level = -1;   // -1: not armed
+        int16_t slot = 0;
+    };
+
+    static constexpr int DUE = LEVELS; // pseudo-level: deadline already processed
+
+    uint64_t now_;            // next tick to be processed
+    size_t count_ = 0;
+    std::vector<Node> nodes_;
+    int heads_[LEVELS][SLOTS];
+    int due_head_ = -1;
+    uint64_t bitmap_[LEVELS][SLOTS / 64];
+
+    void link(int id);
+    void unlink(int id);
+    void cascade(int level);
+    int findSlot(int level, int from) const; // first non-empty slot at offset >= 0 from `from`, or -1
+};
+
+#endif // TIMING_WHEEL_H
@@ -0,0 +1,181 @@
+#include "uring.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef PENREC_HAVE_IO_URING
+
+// =================== init ===================
+int IoUring::init(unsigned entries) {
+    teardown();
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) return -errno;
+    ring_fd_ = fd;
+
+    sq_map_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_map_len_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        if (cq_map_len_ > sq_map_len_) sq_map_len_ = cq_map_len_;
+        cq_map_len_ = sq_map_len_;
+    }
+
+    sq_ptr_ = mmap(nullptr, sq_map_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; int e = errno; teardown(); return -e; }
+
+    if (single) {
+        cq_ptr_ = sq_ptr_;
+    } else {
+        cq_ptr_ = mmap(nullptr, cq_map_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) { cq_ptr_ = nullptr; int e = errno; teardown(); return -e; }
+    }
+
+    sqes_map_len_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ptr_ = mmap(nullptr, sqes_map_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring_fd_, IORING_OFF_SQES);
+    if (sqes_ptr_ == MAP_FAILED) { sqes_ptr_ = nullptr; int e = errno; teardown(); return -e; }
+
+    char* sq = (char*)sq_ptr_;
+    sq_head_ = (unsigned*)(sq + p.sq_off.head);
+    sq_tail_ = (unsigned*)(sq + p.sq_off.tail);
+    sq_mask_ = (unsigned*)(sq + p.sq_off.ring_mask);
+    sq_array_ = (unsigned*)(sq + p.sq_off.array);
+    sq_entries_ = p.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+
+    char* cq = (char*)cq_ptr_;
+    cq_head_ = (unsigned*)(cq + p.cq_off.head);
+    cq_tail_ = (unsigned*)(cq + p.cq_off.tail);
+    cq_mask_ = (unsigned*)(cq + p.cq_off.ring_mask);
+    cqes_ = cq + p.cq_off.cqes;
+    return 0;
+}
+
+// =================== SQ ===================
+struct io_uring_sqe* IoUring::getSqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_local_tail_ - head >= sq_entries_) return nullptr;
+    unsigned idx = sq_local_tail_ & *sq_mask_;
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes_ptr_ + idx;
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[idx] = idx;
+    ++sq_local_tail_;
+    return sqe;
+}
+
+unsigned IoUring::sqSpace() const {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    return sq_entries_ - (sq_local_tail_ - head);
+}
+
+int IoUring::submit(unsigned wait_nr) {
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        // everything published but not yet consumed by the kernel, including
+        // leftovers of an earlier partial submit
+        unsigned to_submit = sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (to_submit == 0 && wait_nr == 0) return 0;
+        int rc = (int)syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr, flags, nullptr, 0);
+        if (rc >= 0) return rc;
+        if (errno == EINTR) continue;
+        return -errno;
+    }
+}
+
+// =================== CQ ===================
+struct io_uring_cqe* IoUring::peekCqe() {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (head == tail) return nullptr;
+    return (struct io_uring_cqe*)cqes_ + (head & *cq_mask_);
+}
+
+void IoUring::cqeSeen() {
+    __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+// =================== prep helpers ===================
+void IoUring::prepConnect(struct io_uring_sqe* sqe, int fd, const struct sockaddr* addr,
+                          socklen_t len, uint64_t user_data) {
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->off = len;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepRecv(struct io_uring_sqe* sqe, int fd, void* buf, unsigned len,
+                       uint64_t user_data) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepSend(struct io_uring_sqe* sqe, int fd, const void* buf, unsigned len,
+                       uint64_t user_data) {
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepClose(struct io_uring_sqe* sqe, int fd, uint64_t user_data) {
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepTimeout(struct io_uring_sqe* sqe, const struct __kernel_timespec* ts,
+                          unsigned flags, uint64_t user_data) {
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)ts;
+    sqe->len = 1;
+    sqe->off = 0;                 // pure timer, not a completion count
+    sqe->timeout_flags = flags;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepLinkTimeout(struct io_uring_sqe* sqe, const struct __kernel_timespec* ts,
+                              uint64_t user_data) {
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)ts;
+    sqe->len = 1;
+    sqe->user_data = user_data;
+}
+
+#else
+
+int IoUring::init(unsigned) {
+    return -ENOSYS;
+}
+
+#endif // PENREC_HAVE_IO_URING
+
+// =================== teardown ===================
+void IoUring::teardown() {
+    if (sqes_ptr_) munmap(sqes_ptr_, sqes_map_len_);
+    if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_map_len_);
+    if (sq_ptr_) munmap(sq_ptr_, sq_map_len_);
+    sqes_ptr_ = cq_ptr_ = sq_ptr_ = nullptr;
+    if (ring_fd_ >= 0) close(ring_fd_);
+    ring_fd_ = -1;
+}
+
+IoUring::~IoUring() {
+    teardown();
+}
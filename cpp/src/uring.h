@@ -0,0 +1,84 @@
+#ifndef URING_H
+#define URING_H
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define PENREC_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#endif
+
+// Minimal io_uring wrapper on top of the raw syscalls (no liburing needed).
+// One instance per thread; nothing here is thread-safe.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // set up a ring with at least `entries` SQEs; returns 0 or -errno
+    // (-ENOSYS when the kernel or the build has no io_uring)
+    int init(unsigned entries);
+    bool ok() const { return ring_fd_ >= 0; }
+
+#ifdef PENREC_HAVE_IO_URING
+    // next free SQE (zeroed), or nullptr when the SQ is full: submit() first
+    struct io_uring_sqe* getSqe();
+
+    // free SQEs; check before starting a linked chain so it is never split
+    unsigned sqSpace() const;
+
+    // hand queued SQEs to the kernel and optionally wait for `wait_nr`
+    // completions; returns the number submitted or -errno
+    int submit(unsigned wait_nr = 0);
+
+    // completion queue access: peek, use, then cqeSeen()
+    struct io_uring_cqe* peekCqe();
+    void cqeSeen();
+
+    // SQE preparation helpers
+    static void prepConnect(struct io_uring_sqe* sqe, int fd, const struct sockaddr* addr,
+                            socklen_t len, uint64_t user_data);
+    static void prepRecv(struct io_uring_sqe* sqe, int fd, void* buf, unsigned len,
+                         uint64_t user_data);
+    static void prepSend(struct io_uring_sqe* sqe, int fd, const void* buf, unsigned len,
+                         uint64_t user_data);
+    static void prepClose(struct io_uring_sqe* sqe, int fd, uint64_t user_data);
+    // standalone timer; flags = IORING_TIMEOUT_ABS for a CLOCK_MONOTONIC deadline
+    static void prepTimeout(struct io_uring_sqe* sqe, const struct __kernel_timespec* ts,
+                            unsigned flags, uint64_t user_data);
+    // timeout for the previous SQE, which must carry IOSQE_IO_LINK
+    static void prepLinkTimeout(struct io_uring_sqe* sqe, const struct __kernel_timespec* ts,
+                                uint64_t user_data);
+#endif
+
+private:
+    int ring_fd_ = -1;
+
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_map_len_ = 0;
+    size_t cq_map_len_ = 0;
+    void* sqes_ptr_ = nullptr;
+    size_t sqes_map_len_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned sq_local_tail_ = 0;   // SQEs handed out but not yet published
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    void* cqes_ = nullptr;
+
+    void teardown();
+};
+
+#endif // URING_H
@@ -0,0 +1,32 @@
+#ifndef CHECK_H
+#define CHECK_H
+#pragma once
+#include <cstdio>
+
+// Just enough for the unit checks: CHECK() reports a failed condition with
+// its place and keeps going, TEST() registers a named check with the
+// runner in test_main.cpp.
+namespace check {
+
+extern int failures;
+
+struct Registrar {
+    Registrar(const char* name, void (*fn)());
+};
+
+} // namespace check
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++check::failures;                                                   \
+        }                                                                        \
+    } while (0)
+
+#define TEST(name)                                              \
+    static void test_##name();                                  \
+    static check::Registrar registrar_##name(#name, test_##name); \
+    static void test_##name()
+
+#endif // CHECK_H
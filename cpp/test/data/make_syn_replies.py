@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+# Writes syn_replies.pcap, the capture test_sniffer.cpp replays: replies
+# to SYN probes sent from 10.77.0.1 / fd77::1, source port 40000, whose
+# sequence numbers are ProbeCookie(key 00..0f) cookies plus the attempt.
+#
+#   1  SYN-ACK  10.77.0.2:22      attempt 0
+#   2  RST      10.77.0.2:23      attempt 1, behind an 802.1Q tag
+#   3  ICMP     host unreachable from 10.77.0.254, quoting 10.77.0.3:80, attempt 2
+#   4  ICMPv6   port unreachable from fd77::2, quoting fd77::2:8765, attempt 0
+#   5  SYN-ACK  10.77.0.2:22 to source port 40001 (not ours, dropped)
+#   6  RST      10.77.0.2:24 with an ack that is no cookie (parsed, then refused)
+#
+#   python3 make_syn_replies.py > syn_replies.pcap
+import ipaddress
+import struct
+import sys
+
+KEY = bytes(range(16))
+SPORT = 40000
+MAC_US = bytes.fromhex("020000000001")
+MAC_PEER = bytes.fromhex("020000000002")
+
+
+def siphash24(key, data):
+    mask = (1 << 64) - 1
+
+    def rotl(x, b):
+        return ((x << b) | (x >> (64 - b))) & mask
+
+    k0, k1 = struct.unpack("<QQ", key)
+    v = [k0 ^ 0x736f6d6570736575, k1 ^ 0x646f72616e646f6d,
+         k0 ^ 0x6c7967656e657261, k1 ^ 0x7465646279746573]
+
+    def rounds(n):
+        for _ in range(n):
+            v[0] = (v[0] + v[1]) & mask; v[1] = rotl(v[1], 13); v[1] ^= v[0]; v[0] = rotl(v[0], 32)
+            v[2] = (v[2] + v[3]) & mask; v[3] = rotl(v[3], 16); v[3] ^= v[2]
+            v[0] = (v[0] + v[3]) & mask; v[3] = rotl(v[3], 21); v[3] ^= v[0]
+            v[2] = (v[2] + v[1]) & mask; v[1] = rotl(v[1], 17); v[1] ^= v[2]; v[2] = rotl(v[2], 32)
+
+    tail = len(data) % 8
+    for i in range(0, len(data) - tail, 8):
+        m = struct.unpack_from("<Q", data, i)[0]
+        v[3] ^= m
+        rounds(2)
+        v[0] ^= m
+    last = (len(data) & 0xff) << 56
+    for i in range(tail):
+        last |= data[len(data) - tail + i] << (8 * i)
+    v[3] ^= last
+    rounds(2)
+    v[0] ^= last
+    v[2] ^= 0xff
+    rounds(4)
+    return v[0] ^ v[1] ^ v[2] ^ v[3]
+
+
+def cookie(src, dst, sport, dport):
+    data = ipaddress.ip_address(src).packed + ipaddress.ip_address(dst).packed
+    return siphash24(KEY, data + struct.pack("!HH", sport, dport)) & 0xffffffff
+
+
+def csum(data):
+    if len(data) % 2:
+        data += b"\0"
+    s = sum(struct.unpack("!%dH" % (len(data) // 2), data))
+    while s >> 16:
+        s = (s & 0xffff) + (s >> 16)
+    return ~s & 0xffff
+
+
+def tcp(src, dst, sport, dport, seq, ack, flags):
+    hdr = struct.pack("!HHIIBBHHH", sport, dport, seq, ack, 5 << 4, flags, 65535, 0, 0)
+    a, b = ipaddress.ip_address(src).packed, ipaddress.ip_address(dst).packed
+    if len(a) == 4:
+        pseudo = a + b + struct.pack("!BBH", 0, 6, len(hdr))
+    else:
+        pseudo = a + b + struct.pack("!IxxxB", len(hdr), 6)
+    return hdr[:16] + struct.pack("!H", csum(pseudo + hdr)) + hdr[18:]
+
+
+def ipv4(src, dst, proto, payload):
+    hdr = struct.pack("!BBHHHBBH4s4s", 0x45, 0, 20 + len(payload), 0, 0, 64, proto, 0,
+                      ipaddress.ip_address(src).packed, ipaddress.ip_address(dst).packed)
+    return hdr[:10] + struct.pack("!H", csum(hdr)) + hdr[12:] + payload
+
+
+def ipv6(src, dst, nh, payload):
+    return struct.pack("!IHBB16s16s", 6 << 28, len(payload), nh, 64,
+                       ipaddress.ip_address(src).packed, ipaddress.ip_address(dst).packed) + payload
+
+
+def icmp6(src, dst, typ, code, body):
+    msg = struct.pack("!BBHI", typ, code, 0, 0) + body
+    pseudo = (ipaddress.ip_address(src).packed + ipaddress.ip_address(dst).packed +
+              struct.pack("!IxxxB", len(msg), 58))
+    return msg[:2] + struct.pack("!H", csum(pseudo + msg)) + msg[4:]
+
+
+def ether(ip, vlan=None):
+    ethertype = 0x86dd if ip[0] >> 4 == 6 else 0x0800
+    tag = struct.pack("!HH", 0x8100, vlan) if vlan is not None else b""
+    return MAC_US + MAC_PEER + tag + struct.pack("!H", ethertype) + ip
+
+
+SYN, RST, ACK = 0x02, 0x04, 0x10
+frames = []
+
+seq = cookie("10.77.0.1", "10.77.0.2", SPORT, 22)
+frames.append(ether(ipv4("10.77.0.2", "10.77.0.1", 6,
+                         tcp("10.77.0.2", "10.77.0.1", 22, SPORT, 0x1000, (seq + 1) & 0xffffffff, SYN | ACK))))
+
+seq = (cookie("10.77.0.1", "10.77.0.2", SPORT, 23) + 1) & 0xffffffff
+frames.append(ether(ipv4("10.77.0.2", "10.77.0.1", 6,
+                         tcp("10.77.0.2", "10.77.0.1", 23, SPORT, 0, (seq + 1) & 0xffffffff, RST | ACK)),
+                    vlan=7))
+
+seq = (cookie("10.77.0.1", "10.77.0.3", SPORT, 80) + 2) & 0xffffffff
+probe = ipv4("10.77.0.1", "10.77.0.3", 6, tcp("10.77.0.1", "10.77.0.3", SPORT, 80, seq, 0, SYN))
+msg = struct.pack("!BBHI", 3, 1, 0, 0) + probe[:28]
+msg = msg[:2] + struct.pack("!H", csum(msg)) + msg[4:]
+frames.append(ether(ipv4("10.77.0.254", "10.77.0.1", 1, msg)))
+
+seq = cookie("fd77::1", "fd77::2", SPORT, 8765)
+probe = ipv6("fd77::1", "fd77::2", 6, tcp("fd77::1", "fd77::2", SPORT, 8765, seq, 0, SYN))
+frames.append(ether(ipv6("fd77::2", "fd77::1", 58, icmp6("fd77::2", "fd77::1", 1, 4, probe))))
+
+seq = cookie("10.77.0.1", "10.77.0.2", SPORT + 1, 22)
+frames.append(ether(ipv4("10.77.0.2", "10.77.0.1", 6,
+                         tcp("10.77.0.2", "10.77.0.1", 22, SPORT + 1, 0x2000, (seq + 1) & 0xffffffff, SYN | ACK))))
+
+frames.append(ether(ipv4("10.77.0.2", "10.77.0.1", 6,
+                         tcp("10.77.0.2", "10.77.0.1", 24, SPORT, 0, 0xdeadbeef, RST | ACK))))
+
+out = struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1)
+for i, f in enumerate(frames):
+    out += struct.pack("<IIII", 1700000000, i * 1000, len(f), len(f)) + f
+sys.stdout.buffer.write(out)
@@ -0,0 +1,69 @@
+// A saved Checkpoint loads back field for field, banners included, and a
+// copy of it cut short anywhere is refused.
+#include "check.h"
+#include "checkpoint.h"
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+TEST(checkpoint) {
+    char dir[] = "/tmp/penrec-test-XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    const std::string path = std::string(dir) + "/scan.ckpt";
+    const std::string cut = std::string(dir) + "/cut.ckpt";
+
+    Checkpoint saved;
+    saved.targets = 0x0123456789abcdefull;
+    saved.hosts = 256;
+    saved.first_port = 1;
+    saved.last_port = 65535;
+    saved.seed = 987654321;
+    saved.position = 4096;
+    ScanResult ssh;
+    ssh.host = 3;
+    ssh.port = 22;
+    ssh.probes = 2;
+    ssh.banner = "SSH-2.0-OpenSSH_9.6\r\n";
+    ScanResult http;
+    http.host = 200;
+    http.port = 8080;
+    saved.open = {ssh, http};
+    CHECK(saved.save(path) == 0);
+
+    Checkpoint loaded;
+    CHECK(loaded.load(path) == 0);
+    CHECK(loaded.targets == saved.targets && loaded.hosts == saved.hosts);
+    CHECK(loaded.first_port == 1 && loaded.last_port == 65535);
+    CHECK(loaded.seed == saved.seed && loaded.position == saved.position);
+    CHECK(loaded.open.size() == 2);
+    if (loaded.open.size() == 2) {
+        CHECK(loaded.open[0].host == 3 && loaded.open[0].port == 22 && loaded.open[0].probes == 2);
+        CHECK(loaded.open[0].open && loaded.open[0].banner == ssh.banner);
+        CHECK(loaded.open[1].host == 200 && loaded.open[1].port == 8080 && loaded.open[1].banner.empty());
+    }
+
+    // every proper prefix but the one missing only the final newline
+    std::ifstream in(path);
+    std::stringstream whole;
+    whole << in.rdbuf();
+    const std::string data = whole.str();
+    bool refused = true;
+    for (size_t len = 0; len + 1 < data.size(); ++len) {
+        std::ofstream(cut, std::ios::trunc) << data.substr(0, len);
+        Checkpoint partial;
+        if (partial.load(cut) != EINVAL) {
+            std::fprintf(stderr, "checkpoint cut at %zu bytes was accepted\n", len);
+            refused = false;
+        }
+    }
+    CHECK(refused);
+
+    Checkpoint missing;
+    CHECK(missing.load(std::string(dir) + "/none.ckpt") == ENOENT);
+
+    unlink(path.c_str());
+    unlink(cut.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,47 @@
+// Runs the checks registered with TEST(): the one named on the command line
+// (as ctest does, one test per module), or all of them.
+//
+//   penrec_tests [name]
+#include "check.h"
+#include <cstring>
+#include <vector>
+
+namespace check {
+
+int failures = 0;
+
+namespace {
+
+struct Entry {
+    const char* name;
+    void (*fn)();
+};
+
+std::vector<Entry>& registry() {
+    static std::vector<Entry> tests;
+    return tests;
+}
+
+} // namespace
+
+Registrar::Registrar(const char* name, void (*fn)()) {
+    registry().push_back(Entry{name, fn});
+}
+
+} // namespace check
+
+int main(int argc, char* argv[]) {
+    int ran = 0;
+    for (const check::Entry& t : check::registry()) {
+        if (argc > 1 && strcmp(argv[1], t.name) != 0) continue;
+        int before = check::failures;
+        t.fn();
+        std::printf("%s %s\n", check::failures == before ? "ok  " : "FAIL", t.name);
+        ++ran;
+    }
+    if (ran == 0) {
+        std::fprintf(stderr, "no test named %s\n", argc > 1 ? argv[1] : "");
+        return 2;
+    }
+    return check::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+// A keyed Permutation visits every index exactly once, position() inverts
+// it, and the same seed gives the same order.
+#include "check.h"
+#include "permutation.h"
+#include <vector>
+
+TEST(permutation) {
+    // sizes around the power-of-4 domain edges, where cycle walking matters
+    const uint64_t sizes[] = {1, 2, 3, 4, 5, 15, 16, 17, 1000, 65536, 65537, 100003};
+    for (uint64_t n : sizes) {
+        Permutation p(n, 0x1234567 + n);
+        CHECK(p.size() == n);
+        std::vector<bool> seen(n, false);
+        bool bijective = true, inverse = true;
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t idx = p(i);
+            if (idx >= n || seen[idx]) {
+                bijective = false;
+                break;
+            }
+            seen[idx] = true;
+            if (p.position(idx) != i) inverse = false;
+        }
+        CHECK(bijective);
+        CHECK(inverse);
+    }
+
+    Permutation a(100003, 42), b(100003, 42), c(100003, 43);
+    bool same = true, differs = false;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        same = same && a(i) == b(i);
+        differs = differs || a(i) != c(i);
+    }
+    CHECK(same);
+    CHECK(differs);
+
+    // identity for a sequential sweep
+    Permutation seq(10);
+    CHECK(!seq.shuffled());
+    CHECK(seq(7) == 7 && seq.position(7) == 7);
+}
@@ -0,0 +1,42 @@
+// SipHash-2-4 matches the reference vectors, and a ProbeCookie tells which
+// attempt a reply acknowledges, for both families, while refusing replies
+// on another tuple, under another key or past the last attempt.
+#include "check.h"
+#include "siphash.h"
+#include <arpa/inet.h>
+
+TEST(probe_cookie) {
+    uint8_t key[16];
+    uint8_t msg[15];
+    for (int i = 0; i < 16; ++i) key[i] = (uint8_t)i;
+    for (int i = 0; i < 15; ++i) msg[i] = (uint8_t)i;
+    CHECK(siphash24(key, msg, 0) == 0x726fdb47dd0e0e31ull);
+    CHECK(siphash24(key, msg, 15) == 0xa129ca6149be45e5ull);
+
+    const ProbeCookie cookie(key);
+    const uint32_t src = htonl(0x0a000001), dst = htonl(0x0a000002);
+    const int max_attempt = 3;
+    for (int a = 0; a <= max_attempt; ++a) {
+        uint32_t ack = cookie.make(src, dst, 40000, 443) + (uint32_t)a + 1;
+        CHECK(cookie.attempt(ack, src, dst, 40000, 443, max_attempt) == a);
+        CHECK(cookie.valid(ack, src, dst, 40000, 443) == (a == 0));
+    }
+    uint32_t ack = cookie.make(src, dst, 40000, 443) + 1;
+    CHECK(cookie.attempt(ack + max_attempt + 1, src, dst, 40000, 443, max_attempt) == -1);
+    CHECK(cookie.attempt(ack - 1, src, dst, 40000, 443, max_attempt) == -1);   // the seq, not its ack
+    CHECK(cookie.attempt(ack, src, dst, 40000, 444, max_attempt) == -1);
+    CHECK(cookie.attempt(ack, src, htonl(0x0a000003), 40000, 443, max_attempt) == -1);
+    CHECK(cookie.attempt(ack, src, dst, 40001, 443, max_attempt) == -1);
+    key[0] ^= 1;
+    CHECK(ProbeCookie(key).attempt(ack, src, dst, 40000, 443, max_attempt) == -1);
+
+    // the IpAddr overload agrees for IPv4 and covers IPv6
+    const IpAddr s4 = IpAddr::fromV4(src), d4 = IpAddr::fromV4(dst);
+    CHECK(cookie.make(s4, d4, 40000, 443) == cookie.make(src, dst, 40000, 443));
+    uint8_t a6[16] = {0xfd, 0x77, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    uint8_t b6[16] = {0xfd, 0x77, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2};
+    const IpAddr s6 = IpAddr::fromV6(a6), d6 = IpAddr::fromV6(b6);
+    uint32_t ack6 = cookie.make(s6, d6, 40000, 8765) + 2 + 1;
+    CHECK(cookie.attempt(ack6, s6, d6, 40000, 8765, max_attempt) == 2);
+    CHECK(cookie.attempt(ack6, d6, s6, 40000, 8765, max_attempt) == -1);
+}
@@ -0,0 +1,61 @@
+// States set out of order over two chunks come back from materialize() in
+// index order, with the detail records merged in where the state alone
+// does not say it all.
+#include "check.h"
+#include "result_store.h"
+#include <cerrno>
+
+TEST(result_store) {
+    TargetSet targets;
+    CHECK(targets.add("10.0.0.1-2") == 0);
+    ResultStore store;
+    store.reset(&targets, 1, 65535, 2);   // host 1 starts in the second chunk
+    CHECK(store.size() == 2 * 65535ull);
+
+    ScanResult open;
+    open.host = 0;
+    open.addr = targets.address(0);
+    open.port = 22;
+    open.open = true;
+    open.banner = "SSH-2.0-test";
+    ScanResult unreach;
+    unreach.host = 1;
+    unreach.addr = targets.address(1);
+    unreach.port = 25;
+    unreach.error_code = EHOSTUNREACH;
+    unreach.probes = 2;
+    ScanResult timed_out;
+    timed_out.error_code = ETIMEDOUT;
+    timed_out.probes = 2;
+    CHECK(!store.implies(open));
+    CHECK(!store.implies(unreach));
+    CHECK(store.implies(timed_out));
+
+    std::vector<ScanResult> details = {unreach, open};
+    store.set(1, 30, PortState::Filtered);
+    store.set(1, 25, ResultStore::stateOf(unreach));
+    store.set(0, 21, PortState::Closed);
+    store.set(0, 22, ResultStore::stateOf(open));
+    store.set(0, 70000, PortState::Open);   // out of range: ignored
+    store.addDetails(details);
+    CHECK(details.empty());
+
+    CHECK(store.state(0, 22) == PortState::Open);
+    CHECK(store.state(1, 25) == PortState::Filtered);
+    CHECK(store.count(PortState::Open) == 1);
+    CHECK(store.count(PortState::Unscanned) == store.size() - 4);
+
+    std::vector<ScanResult> all = store.materialize(false);
+    CHECK(all.size() == 4);
+    if (all.size() == 4) {
+        CHECK(all[0].host == 0 && all[0].port == 21 && !all[0].open && all[0].error_code == ECONNREFUSED);
+        CHECK(all[0].addr == targets.address(0));
+        CHECK(all[1].port == 22 && all[1].open && all[1].banner == "SSH-2.0-test");
+        CHECK(all[2].host == 1 && all[2].port == 25 && all[2].error_code == EHOSTUNREACH);
+        CHECK(all[3].host == 1 && all[3].port == 30 && all[3].error_code == ETIMEDOUT && all[3].probes == 2);
+        CHECK(all[3].addr == targets.address(1));
+    }
+
+    std::vector<ScanResult> opened = store.materialize(true);
+    CHECK(opened.size() == 1 && opened[0].port == 22 && opened[0].banner == "SSH-2.0-test");
+}
@@ -0,0 +1,61 @@
+// Replays data/syn_replies.pcap (see make_syn_replies.py) through the
+// Sniffer's offline path: a SYN-ACK, a VLAN-tagged RST, an ICMP and an
+// ICMPv6 unreachable come out as ProbeReplies, and their acks decode to the
+// attempt each answered under the cookie key the capture was made with.
+#include "check.h"
+#include "siphash.h"
+#include "sniffer.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <vector>
+
+TEST(sniffer) {
+    Sniffer sniffer;
+    CHECK(sniffer.openOffline(PENREC_TEST_DATA "/syn_replies.pcap", 40000) == 0);
+    std::vector<ProbeReply> replies;
+    int n = sniffer.poll(0, [&](const ProbeReply& r) { replies.push_back(r); });
+    CHECK(n == 5);   // the reply to port 40001 is not ours
+    CHECK(sniffer.stats().packets == 6 && sniffer.stats().replies == 5);
+    CHECK(sniffer.poll(0, [](const ProbeReply&) {}) == 0);   // end of file
+    if (replies.size() != 5) return;
+
+    uint8_t key[16];
+    for (int i = 0; i < 16; ++i) key[i] = (uint8_t)i;
+    const ProbeCookie cookie(key);
+    const IpAddr src = IpAddr::fromV4(htonl(0x0a4d0001));   // 10.77.0.1
+    uint8_t src6_bytes[16] = {0xfd, 0x77, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    const IpAddr src6 = IpAddr::fromV6(src6_bytes);
+
+    const ProbeReply& open = replies[0];
+    CHECK(open.kind == ProbeReply::SYN_ACK);
+    CHECK(open.addr.toString() == "10.77.0.2" && open.port == 22 && open.local_port == 40000);
+    CHECK(cookie.attempt(open.ack, src, open.addr, 40000, open.port, 3) == 0);
+
+    const ProbeReply& closed = replies[1];
+    CHECK(closed.kind == ProbeReply::RST);
+    CHECK(closed.addr.toString() == "10.77.0.2" && closed.port == 23);
+    CHECK(cookie.attempt(closed.ack, src, closed.addr, 40000, closed.port, 3) == 1);
+    CHECK(cookie.attempt(closed.ack, src, closed.addr, 40000, closed.port, 0) == -1);
+
+    // ICMP errors describe the quoted probe, not the router that sent them
+    const ProbeReply& unreach = replies[2];
+    CHECK(unreach.kind == ProbeReply::ICMP_UNREACH);
+    CHECK(unreach.addr.toString() == "10.77.0.3" && unreach.port == 80 && unreach.local_port == 40000);
+    CHECK(unreach.icmp_code == 1);
+    CHECK(cookie.attempt(unreach.ack, src, unreach.addr, 40000, unreach.port, 3) == 2);
+
+    const ProbeReply& unreach6 = replies[3];
+    CHECK(unreach6.kind == ProbeReply::ICMP_UNREACH);
+    CHECK(unreach6.addr.toString() == "fd77::2" && unreach6.port == 8765 && unreach6.icmp_code == 4);
+    CHECK(cookie.attempt(unreach6.ack, src6, unreach6.addr, 40000, unreach6.port, 3) == 0);
+
+    // well-formed, but its ack is no cookie of ours
+    const ProbeReply& forged = replies[4];
+    CHECK(forged.kind == ProbeReply::RST && forged.port == 24);
+    CHECK(cookie.attempt(forged.ack, src, forged.addr, 40000, forged.port, 3) == -1);
+
+    // not a pcap file
+    Sniffer other;
+    CHECK(other.openOffline(PENREC_TEST_DATA "/make_syn_replies.py", 40000) == -EINVAL);
+    CHECK(other.openOffline(PENREC_TEST_DATA "/missing.pcap", 40000) == -ENOENT);
+}
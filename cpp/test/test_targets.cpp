@@ -0,0 +1,58 @@
+// TargetSet parses CIDR blocks, dash ranges and IPv6 prefixes of /96 and
+// longer into numbered hosts, maps numbers back to addresses and addresses
+// back to numbers, and refuses malformed or oversized specs.
+#include "check.h"
+#include "targets.h"
+#include <arpa/inet.h>
+#include <cerrno>
+
+TEST(targets) {
+    TargetSet set;
+    // 10.1.2.0/30 holds hosts 0-3, the ranges 4-6 and 7-9, fd77::/126 10-13
+    CHECK(set.add("10.1.2.3/30, 192.168.0.250-192.168.0.252,172.16.0.5-7") == 0);
+    CHECK(set.add("fd77::5/126") == 0);
+    CHECK(set.size() == 14);
+    CHECK(set.address(0).toString() == "10.1.2.0");
+    CHECK(set.address(3).toString() == "10.1.2.3");
+    CHECK(set.address(6).toString() == "192.168.0.252");
+    CHECK(set.address(7).toString() == "172.16.0.5");
+    CHECK(set.address(9).toString() == "172.16.0.7");
+    CHECK(set.address(10).toString() == "fd77::4");
+    CHECK(set.address(13).toString() == "fd77::7");
+
+    TargetSet::Cursor cursor(set);
+    bool agrees = true;
+    for (uint64_t i = 0; i < set.size(); ++i) {
+        uint64_t found;
+        IpAddr a = cursor.address(i);
+        agrees = agrees && a == set.address(i) && set.find(a, found) && found == i;
+    }
+    CHECK(agrees);
+    uint64_t found;
+    CHECK(set.first(AF_INET6, found) && found == 10);
+    CHECK(!set.find(IpAddr::fromV4(htonl(0x08080808)), found));
+
+    // a hostname takes a pending host per family
+    TargetSet named;
+    CHECK(named.add("10.0.0.1,scanme.example.org") == 0);
+    CHECK(named.size() == 3 && named.names().size() == 1);
+    CHECK(named.state(1) == TargetSet::HostState::Pending);
+
+    // the longest IPv6 prefix accepted is /96 (2^32 hosts)
+    TargetSet wide;
+    CHECK(wide.add("2001:db8::/96") == 0);
+    CHECK(wide.size() == (1ull << 32));
+    CHECK(wide.address((1ull << 32) - 1).toString() == "2001:db8::ffff:ffff");
+    CHECK(wide.add("2001:db8::/95") == EINVAL);
+
+    TargetSet bad;
+    const char* refused[] = {"10.0.0.0/33", "10.0.0.300", "10.0.0.20-10", "10.0.0.1-fd77::1",
+                             "10.0.0.1-256", "fd77::1-fd78::1", "10.0.0.0/", "a b"};
+    for (const char* spec : refused) {
+        if (bad.add(spec) != EINVAL) {
+            std::fprintf(stderr, "spec accepted: %s\n", spec);
+            CHECK(false);
+        }
+    }
+    CHECK(bad.size() == 0);
+}
@@ -0,0 +1,45 @@
+// Timers on every level of the wheel fire at their deadline, not a tick
+// early, after being cascaded down; cancelled and re-armed ones do not fire
+// at their old deadline.
+#include "check.h"
+#include "timing_wheel.h"
+#include <algorithm>
+
+TEST(timing_wheel) {
+    TimingWheel w(1000);
+    // deltas landing on levels 0, 1, 2 and 3
+    const uint64_t deadline[4] = {1010, 1000 + 300, 1000 + 70000, 1000 + (1u << 24) + 5};
+    for (int id = 0; id < 4; ++id) w.schedule(id, deadline[id]);
+    w.schedule(4, 1500);
+    w.cancel(4);
+    w.schedule(5, 1200);
+    w.schedule(5, 2000);   // re-armed later
+    CHECK(w.size() == 5);
+    CHECK(!w.armed(4));
+
+    std::vector<int> expired;
+    w.advance(999, expired);
+    CHECK(expired.empty());
+    CHECK(w.nextTimeoutMs(1000) == 10);
+
+    // walk up to each deadline: nothing one tick before, the timer at it
+    int order[5] = {0, 1, 5, 2, 3};
+    uint64_t at[5] = {deadline[0], deadline[1], 2000, deadline[2], deadline[3]};
+    for (int k = 0; k < 5; ++k) {
+        w.advance(at[k] - 1, expired);
+        CHECK(expired.empty());
+        CHECK(w.nextTimeoutMs(at[k] - 1) >= 0);
+        w.advance(at[k], expired);
+        CHECK(expired.size() == 1 && expired[0] == order[k]);
+        CHECK(!w.armed(order[k]));
+        expired.clear();
+    }
+    CHECK(w.empty());
+    CHECK(w.nextTimeoutMs(deadline[3]) == -1);
+
+    // a deadline already passed fires on the next advance
+    w.schedule(7, 10);
+    CHECK(w.nextTimeoutMs(deadline[3]) == 0);
+    w.advance(deadline[3], expired);
+    CHECK(expired.size() == 1 && expired[0] == 7);
+}
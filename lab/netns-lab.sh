@@ -0,0 +1,57 @@
+#!/bin/sh
+# veth + network namespace lab for the raw scan modes (run as root).
+#
+#   ./netns-lab.sh up      # namespace "penrec-lab" at 10.77.0.2 and fd00::2,
+#                          # listeners on 22 80 443 5555 on both
+#   ../build/penrec -t 10.77.0.2 -s 1 -e 65535 --syn
+#   ../build/penrec -t 10.77.0.2,fd00::2 -s 1 -e 65535 --syn
+#   ./netns-lab.sh down
+set -e
+
+NS=penrec-lab
+HOST_IF=penrec0
+NS_IF=penrec1
+HOST_IP=10.77.0.1
+NS_IP=10.77.0.2
+# override if fd00::/64 is already in use on this machine
+HOST_IP6=${HOST_IP6:-fd00::1}
+NS_IP6=${NS_IP6:-fd00::2}
+PORTS="22 80 443 5555"
+
+case "$1" in
+up)
+    ip netns add $NS
+    ip link add $HOST_IF type veth peer name $NS_IF
+    ip link set $NS_IF netns $NS
+    ip addr add $HOST_IP/24 dev $HOST_IF
+    ip -6 addr add $HOST_IP6/64 dev $HOST_IF nodad
+    ip link set $HOST_IF up
+    ip netns exec $NS ip addr add $NS_IP/24 dev $NS_IF
+    ip netns exec $NS ip -6 addr add $NS_IP6/64 dev $NS_IF nodad
+    ip netns exec $NS ip link set $NS_IF up
+    ip netns exec $NS ip link set lo up
+    for p in $PORTS; do
+        ip netns exec $NS python3 -c "
+import socket, threading
+def serve(family, addr):
+    s = socket.socket(family); s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if family == socket.AF_INET6: s.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_V6ONLY, 1)
+    s.bind((addr, $p)); s.listen(128)
+    while True:
+        c, _ = s.accept(); c.sendall(b'penrec-lab $p\r\n'); c.close()
+threading.Thread(target=serve, args=(socket.AF_INET6, '::')).start()
+serve(socket.AF_INET, '0.0.0.0')
+" &
+    done
+    echo "lab up: targets $NS_IP and $NS_IP6, open ports: $PORTS"
+    ;;
+down)
+    ip netns pids $NS 2>/dev/null | xargs -r kill
+    ip link del $HOST_IF 2>/dev/null || true
+    ip netns del $NS
+    ;;
+*)
+    echo "usage: $0 up|down" >&2
+    exit 1
+    ;;
+esac